@@ -23,7 +23,7 @@
 
 #include <tuple>
 #include <cassert>
-#include <thread>
+#include <memory>
 
 #include "backwardSearch.h"
 #include "posetHandle.h"
@@ -37,6 +37,9 @@
 #include "TimeProfile.h"
 #include "linExtCalculator.h"
 #include "searchParams.h"
+#include "threadPool.h"
+#include "workQueue.h"
+#include "eventLog.h"
 
 namespace {
 
@@ -51,14 +54,15 @@ namespace {
         LinExtT limitChildren;
         LinExtT limitParents;
         LinExtT linExtFirstChild;
-        LinearExtensionCalculator linExtCalc;
+        LinearExtensionCalculator &linExtCalc;
         bool computeLinExt;
 
         uint64_t pred_count;
         uint64_t pot_pred_count;
 
     public:
-        BackwardSearch(PosetMap &parentMap, unsigned int parentC, PosetMap &childMap, LinExtT limitChildren, LinExtT limitParent);
+        BackwardSearch(PosetMap &parentMap, unsigned int parentC, PosetMap &childMap, LinExtT limitChildren, LinExtT limitParent,
+                       LinearExtensionCalculator &linExtCalc);
 
         void processPoset(PosetHandle &poset);
 
@@ -143,12 +147,12 @@ namespace {
 
         ExpandedPosetChild revEdgePoset{mat, info, 0, k2, k1};
         auto handle = revEdgePoset.getHandle();
-        PosetObj *result = childMap.find(handle);
+        auto result = childMap.find(handle);
         if (computeLinExt) {
             PosetHandle handle2{handle, PosetInfo(handle)};
             linExtOut = linExtCalc.calculateLinExtensionsSingleton(handle2, parentC + 1, false, true);
             if (linExtOut > (LinExtT(1) << (NCT::C - parentC - 1))) {
-                assert(result == nullptr);
+                assert(!result);
                 return SortableStatus::NO;
             }
         }
@@ -157,7 +161,7 @@ namespace {
             return SortableStatus::UNFINISHED;
         }
 
-        if (result != nullptr) {
+        if (result) {
             return result->GetStatus();
         } else {
             if (computeLinExt && linExtOut < limitChildren) {
@@ -365,34 +369,26 @@ namespace {
         Stats::addVal<AVMSTAT::PotPredCount>(pot_pred_count);
     }
 
-    BackwardSearch::BackwardSearch(PosetMap &parentMap, unsigned int parentC, PosetMap &childMap, LinExtT limitChildren, LinExtT limitParents) :
-            parentMap(parentMap), parentC(parentC), childMap(childMap), limitChildren(limitChildren), limitParents(limitParents), linExtCalc(NCT::N, NCT::C) {
+    BackwardSearch::BackwardSearch(PosetMap &parentMap, unsigned int parentC, PosetMap &childMap, LinExtT limitChildren, LinExtT limitParents,
+                                   LinearExtensionCalculator &linExtCalc) :
+            parentMap(parentMap), parentC(parentC), childMap(childMap), limitChildren(limitChildren), limitParents(limitParents), linExtCalc(linExtCalc) {
         computeLinExt = limitParents > 1;
     }
 
-    void processLayerBW(std::vector<PosetObj>& children, std::atomic<size_t>& childIndex, PosetMap& childMap, PosetMap& parentMap, unsigned int parentC,
-                        std::atomic<float>& progress, LinExtT limitParents, LinExtT limitChildren) {
-
-        NCT::initThread();
+    /**
+     * Processes the children of queue, the children [0, childrenDone) were processed before.
+     */
+    void processLayerBW(ThreadPool::Worker &worker, std::vector<PosetObj>& children, WorkQueue& queue, size_t childrenDone, PosetMap& childMap,
+                        PosetMap& parentMap, unsigned int parentC, std::atomic<float>& progress, LinExtT limitParents, LinExtT limitChildren) {
 
-        BackwardSearch backwardSearch{parentMap, parentC, childMap, limitChildren, limitParents};
+        BackwardSearch backwardSearch{parentMap, parentC, childMap, limitChildren, limitParents, worker.linExtCalculator()};
 
         int cnt = 0;
-        while (true) {
-
-            // grab a batch of posets to process
-            size_t beginIndex = childIndex.fetch_add(SearchParams::batchSize);
-            size_t endIndex = std::min((size_t) children.size(), beginIndex + SearchParams::batchSize);
-
-            // terminate if batch empty
-            if (endIndex <= beginIndex) {
-                break;
-            }
+        size_t beginIndex;
+        size_t endIndex;
+        while (queue.claim(beginIndex, endIndex)) {
 
-            // update progress
-            progress = static_cast<float>(childIndex) / static_cast<float>(children.size());
-
-            // process posets in batch
+            // process posets in chunk
             for (size_t index = beginIndex; index < endIndex; index++) {
                 // get poset
                 PosetObj& poset = children[index];
@@ -401,6 +397,12 @@ namespace {
                 backwardSearch.processPoset(handle);
             }
 
+            // update progress
+            queue.finished(worker.id, endIndex - beginIndex);
+            if (worker.id == 0) {
+                progress = static_cast<float>(childrenDone + queue.done()) / static_cast<float>(children.size());
+            }
+
             if (cnt++ % 100 == 99) {
                 Stats::accumulate();
             }
@@ -456,40 +458,66 @@ std::array<uint64_t, 8> countMarkedPosetsDetailed(std::vector<PosetObj> &vec) {
 }
 
 void doBackwardStep(TimeProfile &profile, std::atomic<float> &progress, PosetStorage& storage, unsigned int parentC,
-                    LinExtT limitParents, LinExtT limitChildren, std::vector<PosetObj> &childList, PosetMap &childMap) {
-
-    profile.section(Section::BW_WORK);
-    PosetMap parentMap{childList.size()};
-    std::atomic<size_t> childIdx = 0;
-    if (childMap.countPosets() > SearchParams::batchSize * 4) {
-        std::vector<std::thread> threads;
-        for (unsigned int i = 0; i < NCT::num_threads; i++) {
-            threads.emplace_back(processLayerBW, std::ref(childList), std::ref(childIdx), std::ref(childMap), std::ref(parentMap), parentC,
-                                 std::ref(progress), limitParents, limitChildren);
+                    LinExtT limitParents, LinExtT limitChildren, std::vector<PosetObj> &childList, PosetMap &childMap, uint64_t parentMemory) {
+
+    Meta meta {
+            .n = NCT::N,
+            .c = parentC,
+            .C = NCT::C,
+            .completeAbove = limitParents,
+            .maxLinExt = {},
+            .numYes = 0,
+            .numUnf = 0,
+    };
+    meta.maxLinExt.fill(LinExtT(1) << (NCT::C - parentC));
+
+    // continue an interrupted run of this step
+    profile.section(Section::BW_IO);
+    const auto &step = storage.resumeStep(meta, PosetStorage::fingerprint(childList));
+    if (step.childrenDone > 0) {
+        EventLog::write(true, "Resuming backward step at child " + std::to_string(step.childrenDone) + " of " + std::to_string(childList.size()) +
+                              " from " + std::to_string(step.shards.size()) + " shards");
+    }
+
+    // the children are processed in rounds, after a round the parents are written to a shard if they use more than parentMemory
+    size_t roundSize = std::max<size_t>(SearchParams::batchSize * NCT::num_threads * 256, childList.size() / 256);
+    auto parentMap = std::make_unique<PosetMap>(childList.size(), parentC);
+    for (size_t roundBegin = step.childrenDone; roundBegin < childList.size();) {
+        size_t roundEnd = std::min(childList.size(), roundBegin + roundSize);
+        profile.section(Section::BW_WORK);
+        bool parallel = roundEnd - roundBegin > SearchParams::batchSize * 4;
+        unsigned int numWorkers = parallel ? NCT::num_threads : 1;
+        WorkQueue queue{roundBegin, roundEnd, numWorkers, SearchParams::batchSize};
+        ThreadPool::run(numWorkers, [&](ThreadPool::Worker &worker) {
+            processLayerBW(worker, childList, queue, roundBegin, childMap, *parentMap, parentC, progress, limitParents, limitChildren);
+        });
+        if (roundEnd < childList.size() && parentMap->memoryBytes() > parentMemory) {
+            profile.section(Section::BW_IO);
+            storage.storeShard(*parentMap, roundEnd);
+            parentMap = std::make_unique<PosetMap>(childList.size(), parentC);
         }
-        for (auto &thread: threads) {
-            thread.join();
+        roundBegin = roundEnd;
+    }
+
+    if (!step.shards.empty()) {
+        // the children are not needed anymore, make room for the whole parent layer
+        profile.section(Section::BW_IO);
+        childList = std::vector<PosetObj>();
+        childMap = PosetMap{1};
+        for (const auto &shard: step.shards) {
+            shard.read(*parentMap);
         }
-    } else {
-        processLayerBW(childList, childIdx, childMap, parentMap, parentC, progress, limitParents, limitChildren);
     }
 
     // stats
     profile.section(Section::OTHER);
-    auto statsAfterP = parentMap.countPosetsDetailed();
+    auto statsAfterP = parentMap->countPosetsDetailed();
     StorageProfile::update(parentC, statsAfterP);
 
     // store new parent posets
     profile.section(Section::BW_IO);
-    Meta meta {
-            .n = NCT::N,
-            .c = parentC,
-            .C = NCT::C,
-            .completeAbove = limitParents,
-            .maxLinExt = {},
-            .numYes = statsAfterP[SortableStatus::YES],
-            .numUnf = statsAfterP[SortableStatus::UNFINISHED],
-    };
-    meta.maxLinExt.fill(LinExtT(1) << (NCT::C - parentC));
-    storage.storePosets(parentMap, meta);
-}
\ No newline at end of file
+    meta.numYes = statsAfterP[SortableStatus::YES];
+    meta.numUnf = statsAfterP[SortableStatus::UNFINISHED];
+    storage.storePosets(*parentMap, meta);
+    storage.finishStep();
+}
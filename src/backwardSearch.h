@@ -36,7 +36,12 @@ class PosetMap;
 
 void createInitialPosetBW(PosetStorage& storage);
 
+/**
+ * Computes and stores the parent layer parentC. Parents are written to shards of the storage whenever they use more
+ * than parentMemory bytes, so an interrupted step is resumed from its last shard. If there are shards, childList and
+ * childMap are released before the shards are merged into the parent layer.
+ */
 void doBackwardStep(TimeProfile &profile, std::atomic<float> &progress, PosetStorage& storage, unsigned int parentC,
-                    LinExtT limitParents, LinExtT limitChildren, std::vector<PosetObj> &childList, PosetMap &childMap);
+                    LinExtT limitParents, LinExtT limitChildren, std::vector<PosetObj> &childList, PosetMap &childMap, uint64_t parentMemory);
 
 #endif //SORTINGLOWERBOUNDS_BACKWARDSEARCH_H
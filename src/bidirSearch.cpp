@@ -23,6 +23,11 @@
 
 #include <string>
 #include <thread>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <memory>
+#include <optional>
 
 #include "bidirSearch.h"
 #include "config.h"
@@ -39,6 +44,9 @@
 #include "searchParams.h"
 #include "utils.h"
 #include "oldGenMap.h"
+#include "offlineStorage.h"
+#include "slabAllocator.h"
+#include "posetCode.h"
 
 static std::chrono::steady_clock::time_point lastStats;
 
@@ -79,7 +87,9 @@ void Search::run() {
 
     if (do_bw_search) {
         EventLog::write(false, "BW Search poset storage directory: " + bw_storage_path);
-        PosetStorage storageBw{bw_storage_path, reuse_bw};
+        // layers that are looked up on disk are used in place and must not be compressed
+        bool compressLayers = bwCompress && !(do_fw_search && bwDiskLayers);
+        PosetStorage storageBw{bw_storage_path, reuse_bw, compressLayers};
 
         std::array<const StorageEntry *, MAXENDC> bwResults{};
 
@@ -106,10 +116,12 @@ void Search::run() {
         }
         EventLog::write(false, "BW Search Params:");
         EventLog::write(false, "  Start Efficiency (c=0): " + std::to_string(c0Efficiency));
+        EventLog::write(false, "  Compressed Layers     : " + std::string(compressLayers ? "yes" : "no"));
         if (do_fw_search) {
             EventLog::write(false, "  Efficiency Bandwidth  : " + std::to_string(effBandwidth));
             EventLog::write(false, "  Efficiency Limit      : " + std::to_string(efficiencyLimitBW));
             EventLog::write(false, "  Full Layers           : " + std::to_string(fullLayers));
+            EventLog::write(false, "  Disk Layer Lookups    : " + std::string(bwDiskLayers ? "yes" : "no"));
             if (effBand2Thr < NCT::C) {
                 EventLog::write(false, "  Efficiency Limit2     : " + std::to_string(efficiencyLimitBW2));
                 EventLog::write(false, "  Efficiency Band Thr2  : " + std::to_string(effBand2Thr));
@@ -131,11 +143,17 @@ void Search::run() {
                     profile.section(Section::BW_IO);
                     const auto &entry = *bwResults[backwardC + 1];
                     const auto &meta = entry.meta;
-                    PosetMap childMapBW{meta.numUnf + meta.numYes};
+                    PosetMap childMapBW{meta.numUnf + meta.numYes, backwardC + 1};
                     entry.read(childMapBW);
                     std::vector<PosetObj> childList;
                     childList.reserve(childMapBW.countPosets());
                     childMapBW.fill(childList);
+                    if (meta.c > backwardC + 1) {
+                        // the layer is from a run with a larger C, its posets with more edges have no parents in layer backwardC
+                        childList.erase(std::remove_if(childList.begin(), childList.end(), [&](const PosetObj &poset) {
+                            return PosetCode::edgeCount(poset) > backwardC + 1;
+                        }), childList.end());
+                    }
 
                     LinExtT minExt = limitParents > meta.getMaxLinExt() ? limitParents - meta.getMaxLinExt() : 1;
                     assert(meta.getMaxLinExt() <= (LinExtT(1) << (NCT::C - backwardC - 1)));
@@ -144,11 +162,11 @@ void Search::run() {
                         const auto &meta2 = entry2.meta;
                         // Check if the layer has posets we need
                         if (meta2.getMaxLinExt() >= minExt) {
-                            entry2.read(childMapBW, true);
+                            entry2.read(childMapBW, true, minExt);
                         }
                     }
 
-                    doBackwardStep(profile, progress, storageBw, backwardC, limitParents, limitChildren, childList, childMapBW);
+                    doBackwardStep(profile, progress, storageBw, backwardC, limitParents, limitChildren, childList, childMapBW, bwParentMemory);
 
                     // print stats if more than 1 minute since last print
                     auto now = std::chrono::steady_clock::now();
@@ -168,7 +186,8 @@ void Search::run() {
                 assert(entry != nullptr);
             } else {
                 EventLog::write(true,
-                                "Using existing bw search results for parentC=" + std::to_string(backwardC) + " from file " + entry->path.filename().string());
+                                "Using existing bw search results for parentC=" + std::to_string(backwardC) + " from file " + entry->path.filename().string() +
+                                (entry->meta.C != NCT::C ? " (C=" + std::to_string(entry->meta.C) + ", c=" + std::to_string(entry->meta.c) + ")" : ""));
                 StorageProfile::update(backwardC, {entry->meta.numUnf, entry->meta.numYes, 0, 0, 0, 0, 0, 0});
             }
             bwResults[backwardC] = entry;
@@ -198,23 +217,43 @@ void Search::run() {
                 } else {
                     const auto &entry = *bwResults[c];
                     const auto &meta = entry.meta;
-                    auto &map = posetMapBW.emplace_back(meta.numUnf + meta.numYes);
+                    // compressed layers of earlier runs have to be loaded
+                    bool onDisk = bwDiskLayers;
+                    for (int c2 = c; c2 <= NCT::C; c2++) {
+                        if (bwResults[c2]->meta.maxLinExt[NCT::C] >= meta.completeAbove && bwResults[c2]->compressed) {
+                            onDisk = false;
+                        }
+                    }
+                    auto &map = onDisk ? posetMapBW.emplace_back(1) : posetMapBW.emplace_back(meta.numUnf + meta.numYes, c);
+                    if (onDisk) {
+                        map.diskLayers = std::make_unique<DiskLayerMap>();
+                    }
                     for (int c2 = c; c2 <= NCT::C; c2++) {
                         const auto &entry2 = *bwResults[c2];
                         const auto &meta2 = entry2.meta;
                         if (meta2.maxLinExt[NCT::C] >= meta.completeAbove) {
-                            entry2.read(map);
+                            if (onDisk) {
+                                map.diskLayers->add(entry2.path);
+                            } else {
+                                entry2.read(map);
+                            }
                         }
                     }
+                    if (onDisk) {
+                        EventLog::write(false, "Disk layers c=" + std::to_string(c) + ": " + std::to_string(map.diskLayers->size()) +
+                                               " posets, directory " + std::to_string(map.diskLayers->directoryBytes() >> 20) + " MiB");
+                    }
                 }
             }
         }
     }
 
     if (do_fw_search) {
-        uint64_t childPosetLimit = activePosetMemory / (sizeof(AnnotatedPosetObj) + sizeof(uint64_t) * 10) / 3;
+        uint64_t childPosetLimit = activePosetMemory / (sizeof(PosetState) + sizeof(AnnotatedPosetObj) + sizeof(EdgeListWord::Type) * 10) / 3;
+        // poset indices in the edge list are relative to their layer and have to fit into an edge list word
+        childPosetLimit = std::min(childPosetLimit, EdgeListWord::maxChildIndex - childPosetOvershoot());
         uint64_t childEdgeLimit = childPosetLimit * 9;
-        uint64_t oldGenEntries = oldGenMemory / sizeof(uint16_t);
+        uint64_t oldGenEntries = oldGenMemory / OldGenMap::bytesPerEntry;
 
         // create storage
         if (std::filesystem::exists(scratchFast)) {
@@ -223,35 +262,40 @@ void Search::run() {
         if (std::filesystem::exists(scratchMedium)) {
             std::filesystem::remove(scratchMedium);
         }
-        boost::interprocess::managed_mapped_file mmap{boost::interprocess::open_or_create, scratchMedium.data(), activePosetMemory / 3 * (NCT::C + 2)};
-        boost::interprocess::managed_mapped_file mmapFast{boost::interprocess::open_or_create, scratchFast.data(), oldGenEntries * (sizeof(PosetObj) + 1)};
+        // the old gen maps are accessed randomly and stay memory mapped, only the sequential spills can use direct io
+        std::optional<boost::interprocess::managed_mapped_file> mmap;
+        std::unique_ptr<OfflineStorage> stateStorage;
+        std::unique_ptr<OfflineStorage> posetStorage;
+        std::unique_ptr<OfflineStorage> edgeStorage;
+        if (scratchDirectIo) {
+            stateStorage = std::make_unique<DirectFileOfflineStorage>(scratchMedium + ".states");
+            posetStorage = std::make_unique<DirectFileOfflineStorage>(scratchMedium + ".posets");
+            edgeStorage = std::make_unique<DirectFileOfflineStorage>(scratchMedium + ".edges");
+        } else {
+            mmap.emplace(boost::interprocess::open_or_create, scratchMedium.data(), activePosetMemory / 3 * (NCT::C + 2));
+            stateStorage = std::make_unique<MmapOfflineStorage>(mmap->get_segment_manager());
+            posetStorage = std::make_unique<MmapOfflineStorage>(mmap->get_segment_manager());
+            edgeStorage = std::make_unique<MmapOfflineStorage>(mmap->get_segment_manager());
+        }
+        boost::interprocess::managed_mapped_file mmapFast{boost::interprocess::open_or_create, scratchFast.data(), oldGenEntries * (PosetCode::maxSlotBytes + 1)};
 
-        SemiOfflineVector<AnnotatedPosetObj> posetList{childPosetLimit * 3, childPosetLimit * NCT::C, mmap.get_segment_manager()};
-        SemiOfflineVector<uint64_t> edgeList{childEdgeLimit * 3, childEdgeLimit * NCT::C, mmap.get_segment_manager()};
+        PosetList posetList{childPosetLimit * 3, childPosetLimit * NCT::C, std::move(stateStorage), std::move(posetStorage)};
+        SemiOfflineVector<EdgeListWord::Type> edgeList{childEdgeLimit * 3, childEdgeLimit * NCT::C, std::move(edgeStorage)};
         layerState.resize(NCT::C + 1);
         oldGenMap.reserve(NCT::C + 1);
-        uint64_t oldGenSmall = oldGenEntries / 100 / NCT::C;
-        uint64_t oldGenMedium = oldGenSmall + (oldGenEntries / 100 * 49) / (NCT::C * 2 / 5 + 1);
-        uint64_t oldGenBig = oldGenMedium + (oldGenEntries / 100 * 50) / (NCT::C * 2 / 5 / 4 + 1);
-        unsigned oldGenMediumBegin = NCT::C * 2 / 5 + 3;
-        unsigned oldGenMediumEnd = NCT::C * 4 / 5;
-        if (NCT::N == 18) {
-            oldGenMediumBegin = 30;
-            oldGenMediumEnd = 40;
-            oldGenSmall = oldGenEntries / 10000 / NCT::C;
-            oldGenMedium = oldGenSmall + (oldGenEntries / 100 * 99) / (oldGenMediumEnd - oldGenMediumBegin);
-        }
+        auto oldGenSizes = planOldGenSizes(oldGenEntries);
         for (int i = 0; i <= NCT::C; i++) {
-            if (i < oldGenMediumBegin || i >= oldGenMediumEnd) {
-                oldGenMap.emplace_back(mmapFast.get_segment_manager(), oldGenSmall);
-            } else if ((i - oldGenMediumBegin) % 4 == 3 && NCT::N != 18) {
-                oldGenMap.emplace_back(mmapFast.get_segment_manager(), oldGenBig);
-            } else {
-                oldGenMap.emplace_back(mmapFast.get_segment_manager(), oldGenMedium);
+            oldGenMap.emplace_back(mmapFast.get_segment_manager(), oldGenSizes[i], i);
+        }
+        if (!oldGenSnapshotPath.empty()) {
+            unsigned int loaded = 0;
+            for (unsigned int i = 0; i <= NCT::C; i++) {
+                loaded += oldGenMap[i].load(oldGenSnapshotFile(i));
             }
+            EventLog::write(false, "Loaded old gen snapshots for " + std::to_string(loaded) + " layers from " + oldGenSnapshotPath);
         }
         std::vector<uint64_t> tempVec;
-        tempVec.reserve(childPosetLimit + 100000);
+        tempVec.reserve(childPosetLimit + childPosetOvershoot());
         PosetMapExt childMap{posetList, childPosetLimit};
 
         if (!do_bw_search) {
@@ -291,8 +335,8 @@ void Search::run() {
             // check termination
             profile.section(Section::OTHER);
             if (forwardC == 0) {
-                posetList.ensureOnlineFrom(0);
-                auto status = posetList[0].GetStatus();
+                posetList.ensureStatesOnlineFrom(0);
+                auto status = posetList.state(0).GetStatus();
                 if (status == SortableStatus::YES) {
                     result = std::to_string(NCT::N) + " elements SORTABLE in " + std::to_string(NCT::C) + " comparisons";
                     break;
@@ -327,6 +371,14 @@ void Search::run() {
         EventLog::write(false, "Old Gen Map Profile:");
         for (auto &line: getMapProfile())
             EventLog::write(false, line);
+        storeOldGenProfile();
+        if (!oldGenSnapshotPath.empty()) {
+            EventLog::write(false, "Storing old gen snapshots to " + oldGenSnapshotPath);
+            std::filesystem::create_directories(oldGenSnapshotPath);
+            for (unsigned int i = 0; i < oldGenMap.size(); i++) {
+                oldGenMap[i].save(oldGenSnapshotFile(i));
+            }
+        }
         oldGenMap.clear();
     }
 
@@ -340,6 +392,7 @@ void Search::run() {
         for (auto &line: StorageProfile::summary())
             EventLog::write(false, line);
     }
+    EventLog::write(false, SlabAllocator::summary());
     EventLog::write(false, profile.summary());
     EventLog::write(false, result);
 
@@ -388,8 +441,122 @@ std::vector<std::string> Search::getMapProfile() {
         outLine << "\t ALL: " << std::left << std::setw(11) << (sprofile[SortableStatus::YES] + sprofile[SortableStatus::NO]);
         outLine << "\t YES: " << std::left << std::setw(11) << sprofile[SortableStatus::YES];
         outLine << "\t NO: " << std::left << std::setw(11) << sprofile[SortableStatus::NO];
+        outLine << "\t EVICT: " << std::left << std::setw(11) << oldGenMap[c].evictions;
+        outLine << "\t REJECT: " << std::left << std::setw(11) << oldGenMap[c].rejections;
+        double hitRate = oldGenMap[c].lookups > 0 ? 100.0 * oldGenMap[c].hits / oldGenMap[c].lookups : 0.0;
+        outLine << "\t HIT: " << std::fixed << std::setprecision(1) << hitRate << "% of " << oldGenMap[c].lookups;
         result.push_back(outLine.str());
     }
     result.push_back("Total elements: " + std::to_string(totalNum));
     return result;
-}
\ No newline at end of file
+}
+
+std::string Search::oldGenSnapshotFile(unsigned int layer) const {
+    return oldGenSnapshotPath + "/oldGen_" + std::to_string(NCT::N) + "_" + std::to_string(NCT::C) + "_" +
+           std::to_string(layer) + ".bin";
+}
+
+std::string Search::oldGenProfilePath() const {
+    return bw_storage_path + "/oldGenProfile_" + std::to_string(NCT::N) + "_" + std::to_string(NCT::C) + ".txt";
+}
+
+void Search::storeOldGenProfile() const {
+    // keep the previous profile if this run was answered from snapshots
+    bool inserted = std::any_of(oldGenMap.cbegin(), oldGenMap.cend(), [](const OldGenMap &map) {
+        return map.profile[SortableStatus::YES] + map.profile[SortableStatus::NO] > 0;
+    });
+    if (!inserted) {
+        return;
+    }
+    std::filesystem::create_directories(bw_storage_path);
+    std::ofstream file{oldGenProfilePath()};
+    for (unsigned int c = 0; c < oldGenMap.size(); c++) {
+        const auto &map = oldGenMap[c];
+        file << c << " " << (map.profile[SortableStatus::YES] + map.profile[SortableStatus::NO]) << " " << map.lookups
+             << " " << map.hits << "\n";
+    }
+    if (!file) {
+        EventLog::write(false, "Could not store old gen profile to " + oldGenProfilePath());
+    }
+}
+
+std::vector<uint64_t> Search::planOldGenSizes(uint64_t oldGenEntries) const {
+    std::vector<uint64_t> sizes;
+    sizes.reserve(NCT::C + 1);
+
+    std::vector<uint64_t> inserts(NCT::C + 1, 0);
+    std::vector<uint64_t> lookups(NCT::C + 1, 0);
+    std::ifstream file{oldGenProfilePath()};
+    unsigned int c;
+    uint64_t layerInserts, layerLookups, layerHits;
+    bool haveProfile = false;
+    while (file >> c >> layerInserts >> layerLookups >> layerHits) {
+        if (c <= NCT::C) {
+            inserts[c] = layerInserts;
+            lookups[c] = layerLookups;
+            haveProfile = haveProfile || layerInserts > 0;
+        }
+    }
+
+    if (!haveProfile) {
+        uint64_t oldGenSmall = oldGenEntries / 100 / NCT::C;
+        uint64_t oldGenMedium = oldGenSmall + (oldGenEntries / 100 * 49) / (NCT::C * 2 / 5 + 1);
+        uint64_t oldGenBig = oldGenMedium + (oldGenEntries / 100 * 50) / (NCT::C * 2 / 5 / 4 + 1);
+        unsigned oldGenMediumBegin = NCT::C * 2 / 5 + 3;
+        unsigned oldGenMediumEnd = NCT::C * 4 / 5;
+        if (NCT::N == 18) {
+            oldGenMediumBegin = 30;
+            oldGenMediumEnd = 40;
+            oldGenSmall = oldGenEntries / 10000 / NCT::C;
+            oldGenMedium = oldGenSmall + (oldGenEntries / 100 * 99) / (oldGenMediumEnd - oldGenMediumBegin);
+        }
+        for (int i = 0; i <= NCT::C; i++) {
+            if (i < oldGenMediumBegin || i >= oldGenMediumEnd) {
+                sizes.push_back(oldGenSmall);
+            } else if ((i - oldGenMediumBegin) % 4 == 3 && NCT::N != 18) {
+                sizes.push_back(oldGenBig);
+            } else {
+                sizes.push_back(oldGenMedium);
+            }
+        }
+        return sizes;
+    }
+
+    // every layer gets a small share, the rest is distributed proportional to the lookups (where entries save
+    // recomputation), but no layer gets more than it can fill
+    uint64_t minSize = oldGenEntries / 100 / (NCT::C + 1);
+    uint64_t remaining = oldGenEntries - minSize * (NCT::C + 1);
+    sizes.assign(NCT::C + 1, minSize);
+    for (bool capped : {true, false}) {
+        while (remaining > 0) {
+            double weightSum = 0;
+            for (c = 0; c <= NCT::C; c++) {
+                if (!capped || sizes[c] < inserts[c]) {
+                    weightSum += static_cast<double>(lookups[c] + 1);
+                }
+            }
+            if (weightSum == 0) {
+                break;
+            }
+            uint64_t distributed = 0;
+            for (c = 0; c <= NCT::C; c++) {
+                if (capped && sizes[c] >= inserts[c]) {
+                    continue;
+                }
+                auto share = static_cast<uint64_t>(static_cast<double>(remaining) * (lookups[c] + 1) / weightSum);
+                if (capped) {
+                    share = std::min(share, inserts[c] - sizes[c]);
+                }
+                sizes[c] += share;
+                distributed += share;
+            }
+            remaining -= distributed;
+            if (distributed == 0 || !capped) {
+                break;
+            }
+        }
+    }
+
+    EventLog::write(false, "Old gen map sizes from profile " + oldGenProfilePath());
+    return sizes;
+}
@@ -40,11 +40,17 @@ public:
     //static constexpr std::string_view  scratchMedium = "/scratch_medium/usfs/test2.mmap";
     std::string scratchFast;
     std::string scratchMedium;
+    // spill the forward search lists to scratchMedium with O_DIRECT instead of through a memory mapped file
+    bool scratchDirectIo = false;
     std::string bw_storage_path;
+    // directory for OldGenMap snapshots, empty if disabled
+    std::string oldGenSnapshotPath;
     // static constexpr uint64_t activePosetMemory = 150'000'000'000;
     // static constexpr uint64_t oldGenMemory = 100'000'000'000;
     uint64_t activePosetMemory = 100'000'000;
     uint64_t oldGenMemory = 100'000'000;
+    // parents of a bw step that are kept in RAM before they are written to a shard
+    uint64_t bwParentMemory = 4'000'000'000;
 
     TimeProfile profile;
     std::atomic<float> progress;
@@ -59,6 +65,10 @@ public:
 
     double effBandwidth;
     unsigned int fullLayers;
+    // serve the bw layers of the forward search from the layer files instead of loading them into hash maps
+    bool bwDiskLayers = false;
+    // store the bw layers in compressed blocks
+    bool bwCompress = true;
 
     double effBandwidth2;
     unsigned int effBand2Thr = MAXC;
@@ -69,6 +79,20 @@ public:
 
     std::vector<std::string> getFwProfile();
     std::vector<std::string> getMapProfile();
+
+private:
+    /**
+     * Capacity of the OldGenMap of each layer. If a previous forward search for the same N and C stored its profile
+     * in the bw storage directory, the entries are distributed according to the observed number of inserts and lookups.
+     * Otherwise a fixed split into small, medium and big maps is used.
+     */
+    [[nodiscard]] std::vector<uint64_t> planOldGenSizes(uint64_t oldGenEntries) const;
+
+    void storeOldGenProfile() const;
+
+    [[nodiscard]] std::string oldGenProfilePath() const;
+
+    [[nodiscard]] std::string oldGenSnapshotFile(unsigned int layer) const;
 };
 
 #endif //SORTINGLOWERBOUNDS_BIDIRSEARCH_H
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "diskLayerMap.h"
+
+#include "storeAndLoad.h"
+#include "isoTest.h"
+#include "stats.h"
+
+DiskLayerMap::DiskLayerMap() = default;
+
+DiskLayerMap::~DiskLayerMap() = default;
+
+void DiskLayerMap::add(const std::filesystem::path &path) {
+    auto &layer = layers.emplace_back();
+    layer.view = std::make_unique<StorageLayerView>(path);
+    const auto &header = layer.view->header();
+    // records are read in place
+    assert(!header.isCompressed());
+
+    for (uint32_t p = 0; p < header.numPartitions; p++) {
+        const auto &partition = layer.view->partitions()[p];
+        auto bucketIndex = layer.view->bucketIndex(partition);
+        layer.partitions.push_back(Partition{{bucketIndex, bucketIndex + (1ULL << partition.bucketBits) + 1}, partition.bucketBits});
+    }
+
+    // one sequential pass over the file, afterwards it is only read by lookups
+    auto records = layer.view->records();
+    layer.fingerprints.resize(header.numRecords);
+    for (uint64_t i = 0; i < header.numRecords; i++) {
+        layer.fingerprints[i] = StorageLayerView::fingerprintOf(records[i].hash);
+    }
+    layer.view->adviseRandom();
+}
+
+std::optional<PosetObj> DiskLayerMap::find(const AnnotatedPosetObj &candidate) const {
+    Stats::inc(STAT::NChildMapDiskFind);
+    uint64_t hash = candidate.GetHash();
+    uint16_t fingerprint = StorageLayerView::fingerprintOf(hash);
+    for (const auto &layer: layers) {
+        for (const auto &partition: layer.partitions) {
+            auto bucket = StorageLayerView::bucketOf(hash, partition.bucketBits);
+            for (uint64_t i = partition.buckets[bucket]; i < partition.buckets[bucket + 1]; i++) {
+                if (layer.fingerprints[i] != fingerprint) {
+                    continue;
+                }
+                Stats::inc(STAT::NChildMapDiskRead);
+                const auto &record = layer.view->records()[i];
+                if (record.hash == hash && isSamePoset(candidate, record.poset)) {
+                    return record.poset;
+                }
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+void DiskLayerMap::prefetch(const AnnotatedPosetObj &candidate) const {
+    for (const auto &layer: layers) {
+        for (const auto &partition: layer.partitions) {
+            __builtin_prefetch(&partition.buckets[StorageLayerView::bucketOf(candidate.GetHash(), partition.bucketBits)]);
+        }
+    }
+}
+
+uint64_t DiskLayerMap::size() const {
+    uint64_t result = 0;
+    for (const auto &layer: layers) {
+        result += layer.fingerprints.size();
+    }
+    return result;
+}
+
+uint64_t DiskLayerMap::directoryBytes() const {
+    uint64_t result = 0;
+    for (const auto &layer: layers) {
+        for (const auto &partition: layer.partitions) {
+            result += partition.buckets.size() * sizeof(uint64_t);
+        }
+        result += layer.fingerprints.size() * sizeof(uint16_t);
+    }
+    return result;
+}
@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_DISKLAYERMAP_H
+#define SORTINGLOWERBOUNDS_DISKLAYERMAP_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "posetObj.h"
+
+class StorageLayerView;
+
+/**
+ * Lookups in stored backward search layers without loading them into a hash map. The layer files stay memory mapped,
+ * only their bucket indices and a 16 bit fingerprint per record are kept in RAM. A lookup reads records from disk only
+ * if a fingerprint in the bucket matches, so most negative lookups need no I/O and positive ones about one page.
+ * The mapping is read only, pages are cached by the kernel and dropped under memory pressure. Compressed layer files
+ * cannot be used.
+ */
+class DiskLayerMap {
+
+    struct Partition {
+        std::vector<uint64_t> buckets;
+        uint32_t bucketBits;
+    };
+
+    struct Layer {
+        std::unique_ptr<StorageLayerView> view;
+        std::vector<Partition> partitions;
+        std::vector<uint16_t> fingerprints;
+    };
+
+    std::vector<Layer> layers;
+
+public:
+    DiskLayerMap();
+    ~DiskLayerMap();
+
+    DiskLayerMap(const DiskLayerMap&) = delete;
+    DiskLayerMap& operator= (const DiskLayerMap&) = delete;
+
+    /**
+     * Adds a layer file. Layers are searched in the order they are added.
+     */
+    void add(const std::filesystem::path &path);
+
+    /**
+     * Find a poset in the layers. Returns an empty optional if not found.
+     */
+    [[nodiscard]] std::optional<PosetObj> find(const AnnotatedPosetObj &candidate) const;
+
+    /**
+     * Prefetch the directory entries of the candidate.
+     */
+    void prefetch(const AnnotatedPosetObj &candidate) const;
+
+    [[nodiscard]] uint64_t size() const;
+
+    /**
+     * RAM used by bucket indices and fingerprints.
+     */
+    [[nodiscard]] uint64_t directoryBytes() const;
+};
+
+#endif //SORTINGLOWERBOUNDS_DISKLAYERMAP_H
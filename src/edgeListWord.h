@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_EDGELISTWORD_H
+#define SORTINGLOWERBOUNDS_EDGELISTWORD_H
+
+#include <cstdint>
+#include <cassert>
+
+/**
+ * Words of the forward search edge list. The parents of a layer are stored relative to the begin of the layer. The
+ * edge list of a parent is its number of words followed by the children of its open comparisons, relative to the
+ * begin of the child layer: one word if only one child has to be sorted, two words otherwise. The low bit of a child
+ * word is set for single children.
+ */
+class EdgeListWord {
+public:
+    typedef uint32_t Type;
+
+    static constexpr uint64_t maxParentIndex = UINT32_MAX;
+    static constexpr uint64_t maxChildIndex = UINT32_MAX >> 1;
+
+    static inline Type parent(uint64_t index, uint64_t layerBegin) {
+        assert(index >= layerBegin && index - layerBegin <= maxParentIndex);
+        return static_cast<Type>(index - layerBegin);
+    }
+
+    static inline uint64_t parentIndex(Type word, uint64_t layerBegin) {
+        return layerBegin + word;
+    }
+
+    static inline Type single(uint64_t index, uint64_t childLayerBegin) {
+        assert(index >= childLayerBegin && index - childLayerBegin <= maxChildIndex);
+        return static_cast<Type>((index - childLayerBegin) << 1 | 1);
+    }
+
+    static inline Type pair(uint64_t index, uint64_t childLayerBegin) {
+        assert(index >= childLayerBegin && index - childLayerBegin <= maxChildIndex);
+        return static_cast<Type>((index - childLayerBegin) << 1);
+    }
+
+    static inline bool isSingle(Type word) {
+        return word & 1;
+    }
+
+    static inline uint64_t childIndex(Type word, uint64_t childLayerBegin) {
+        return childLayerBegin + (word >> 1);
+    }
+};
+
+#endif //SORTINGLOWERBOUNDS_EDGELISTWORD_H
@@ -25,6 +25,8 @@
 #include <thread>
 #include <parallel/algorithm>
 #include <fstream>
+#include <numeric>
+#include <optional>
 
 #include "forwardSearch.h"
 #include "expandedPoset.h"
@@ -37,10 +39,49 @@
 #include "eventLog.h"
 #include "TimeProfile.h"
 #include "state.h"
-#include "semiOfflineVector.h"
+#include "posetList.h"
+#include "edgeListWord.h"
+#include "threadPool.h"
+#include "workQueue.h"
+
+namespace {
+    // a parent makes at most one comparison per pair of elements, each comparison adds at most two children and two
+    // edge list words, plus the size word of the parent's edge list
+    inline uint64_t maxChildPosetsPerParent() {
+        return static_cast<uint64_t>(NCT::N) * (NCT::N - 1);
+    }
+
+    inline uint64_t maxChildEdgesPerParent() {
+        return maxChildPosetsPerParent() + 1;
+    }
 
-void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
-                   SemiOfflineVector<uint64_t> &edgeList,
+    /**
+     * Appends the values that select(i, buffer) pushes to buffer for the items i of [begin, end) to out, in the order
+     * of the items. Large ranges are split over the workers: each collects its part in its own buffer, then the buffers
+     * are copied to out at the prefix sums of their sizes.
+     */
+    template<typename Select>
+    void collect(uint64_t begin, uint64_t end, std::vector<uint64_t> &out, Select select) {
+        std::vector<size_t> offsets(NCT::num_threads + 1, 0);
+        ThreadPool::runRange(end - begin, [&](ThreadPool::Worker &worker, size_t first, size_t last) {
+            auto &buffer = worker.childIndices;
+            buffer.clear();
+            for (auto i = begin + first; i < begin + last; i++) {
+                select(i, buffer);
+            }
+            offsets[worker.id + 1] = buffer.size();
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        size_t outBegin = out.size();
+        out.resize(outBegin + offsets.back());
+        ThreadPool::runRange(end - begin, [&](ThreadPool::Worker &worker, size_t, size_t) {
+            std::copy(worker.childIndices.cbegin(), worker.childIndices.cend(), out.begin() + outBegin + offsets[worker.id]);
+        });
+    }
+}
+
+void doForwardStep(PosetList &posetList,
+                   SemiOfflineVector<EdgeListWord::Type> &edgeList,
                    LayerState &parentState,
                    LayerState &childState,
                    unsigned int &parentC,
@@ -56,6 +97,9 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                    const uint64_t childPosetLimit,
                    const uint64_t childEdgeLimit) {
 
+    // the children of every slice of the parents are appended to the end of the parent layer
+    const size_t childLayerBegin = parentState.posetListEnd;
+
     if (parentState.phase >= 2) {
 
         if (parentState.phase == 2) {
@@ -65,29 +109,33 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
             Stats::inc(STAT::NPhase3);
         }
 
-        std::atomic<size_t> parentIndex;
+        std::optional<WorkQueue> queue;
         std::atomic<bool> hasUnfinished = false;
-        auto processThread = [&]() {
+        auto processThread = [&](ThreadPool::Worker &worker) {
 
-            std::vector<uint64_t> localEdgeList;
+            // children of the comparisons that are still open
+            std::vector<uint64_t> &localEdgeList = worker.childIndices;
 
-            auto processPoset = [&](AnnotatedPosetObj &entry) {
+            auto processPoset = [&](PosetState &entry) {
 
                 assert(entry.GetStatus() == SortableStatus::UNFINISHED);
 
                 localEdgeList.clear();
-                auto elIndex = entry.elIndex;
+                auto elIndex = entry.getElIndex();
                 assert(elIndex >= parentState.elBegin);
                 auto elSize = edgeList[elIndex++];
-                assert(elSize % 2 == 0);
 
                 bool unsortable = true;
-                for (int i = 0; i < elSize; i += 2) {
-                    auto idxFirst = edgeList[elIndex + i];
-                    auto idxSecond = edgeList[elIndex + i + 1];
+                for (size_t i = 0; i < elSize;) {
+                    auto word = edgeList[elIndex + i++];
+                    auto idxFirst = EdgeListWord::childIndex(word, childLayerBegin);
+                    auto idxSecond = idxFirst;
+                    if (!EdgeListWord::isSingle(word)) {
+                        idxSecond = EdgeListWord::childIndex(edgeList[elIndex + i++], childLayerBegin);
+                    }
                     assert(parentState.phase == 2 || idxFirst == idxSecond);
-                    auto &first = posetList[idxFirst];
-                    auto &second = posetList[idxSecond];
+                    auto &first = posetList.state(idxFirst);
+                    auto &second = posetList.state(idxSecond);
                     auto firstSortable = first.GetStatus() == SortableStatus::YES;
                     auto secondSortable = second.GetStatus() == SortableStatus::YES;
                     if (firstSortable && secondSortable) {
@@ -97,11 +145,9 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                                || second.GetStatus() == SortableStatus::NO) {
                         // do nothing
                     } else if (firstSortable) {
-                        localEdgeList.push_back(idxSecond);
                         localEdgeList.push_back(idxSecond);
                         unsortable = false;
                     } else if (secondSortable) {
-                        localEdgeList.push_back(idxFirst);
                         localEdgeList.push_back(idxFirst);
                         unsortable = false;
                     } else {
@@ -114,36 +160,27 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                     return;
                 }
 
-                // update edge list
+                // update edge list, only single children remain
                 auto newElSize = localEdgeList.size();
                 assert(newElSize <= elSize);
                 edgeList[elIndex - 1] = newElSize;
                 for (size_t i = 0; i < newElSize; i++) {
-                    edgeList[elIndex + i] = localEdgeList[i];
+                    edgeList[elIndex + i] = EdgeListWord::single(localEdgeList[i], childLayerBegin);
                     Stats::inc(STAT::NMarkSecond);
-                    posetList[localEdgeList[i]].setMark(true);
+                    posetList.state(localEdgeList[i]).markConcurrent();
                 }
                 hasUnfinished = true;
-                Stats::addVal<AVMSTAT::ELSizePhase2>(newElSize / 2);
+                Stats::addVal<AVMSTAT::ELSizePhase2>(newElSize);
             };
 
-            NCT::initThread();
+            size_t beginIndex;
+            size_t endIndex;
+            while (queue->claim(beginIndex, endIndex)) {
 
-            while (true) {
-
-                // grab a batch of posets to process
-                size_t beginIndex = parentIndex.fetch_add(SearchParams::batchSize);
-                size_t endIndex = std::min(parentState.parentsSliceEnd, beginIndex + SearchParams::batchSize);
-
-                // terminate if batch empty
-                if (endIndex <= beginIndex) {
-                    break;
-                }
-
-                // process posets in batch
+                // process posets in chunk
                 for (size_t index = beginIndex; index < endIndex; index++) {
                     // get poset
-                    auto &parent = posetList[edgeList[index]];
+                    auto &parent = posetList.state(EdgeListWord::parentIndex(edgeList[index], parentState.posetListBegin));
                     if (!parent.isMarked() || parent.GetStatus() != SortableStatus::UNFINISHED) {
                         continue;
                     }
@@ -156,26 +193,21 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
             Stats::accumulate();
         };
 
-        // io
+        // io, phase 2 only needs the states of the posets
         profile.section(Section::FW_IO);
-        posetList.ensureOnlineFrom(parentState.posetListBegin);
+        std::thread posetListIo([&]() {
+            posetList.ensureStatesOnlineFrom(parentState.posetListBegin);
+        });
         edgeList.ensureOnlineFrom(parentState.parentsBegin);
+        posetListIo.join();
 
         profile.section(Section::FW_PHASE2);
         EventLog::write(true, "Processing layer c=" + std::to_string(parentC) +
                               " phase " + std::to_string(parentState.phase));
-        parentIndex = parentState.parentsSliceBegin;
-        if ((parentState.parentsSliceEnd - parentState.parentsSliceBegin) > SearchParams::batchSize * 4) {
-            std::vector<std::thread> threads;
-            for (unsigned int i = 0; i < NCT::num_threads; i++) {
-                threads.emplace_back(processThread);
-            }
-            for (auto &thread: threads) {
-                thread.join();
-            }
-        } else {
-            processThread();
-        }
+        bool parallel = (parentState.parentsSliceEnd - parentState.parentsSliceBegin) > SearchParams::batchSize * 4;
+        unsigned int numWorkers = parallel ? NCT::num_threads : 1;
+        queue.emplace(parentState.parentsSliceBegin, parentState.parentsSliceEnd, numWorkers, SearchParams::batchSize);
+        ThreadPool::run(numWorkers, processThread);
 
         if (parentState.phase == 3) {
             assert(hasUnfinished == false);
@@ -197,41 +229,46 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
             if (parentState.parentsSliceEnd == parentState.parentsEnd) {
 
                 // store parents in offline hash map!!!
+                posetList.ensurePosetsOnlineFrom(parentState.posetListBegin);
                 profile.section(Section::FW_OLDGEN);
                 tempVec.clear();
-                for (auto i = parentState.parentsBegin; i < parentState.parentsEnd; i++) {
-                    auto &poset = posetList[edgeList[i]];
+                // every parent is listed once, its state is only changed by the worker that owns its part of the list
+                collect(parentState.parentsBegin, parentState.parentsEnd, tempVec, [&](uint64_t i, std::vector<uint64_t> &buffer) {
+                    auto posetIndex = EdgeListWord::parentIndex(edgeList[i], parentState.posetListBegin);
+                    auto &poset = posetList.state(posetIndex);
                     if (poset.isMarked() && poset.GetStatus() != SortableStatus::UNFINISHED) {
-                        tempVec.push_back(edgeList[i]);
+                        buffer.push_back(posetIndex);
                         // unmark here
                         poset.setMark(false);
                     }
-                }
-                auto size = parentMapOld.size;
+                });
                 __gnu_parallel::sort(tempVec.begin(), tempVec.end(), [&](uint64_t a, uint64_t b) {
-                    return ((posetList[a].GetHash() * MULT1) % size) < ((posetList[b].GetHash() * MULT1) % size);
+                    return parentMapOld.setIndex(posetList.poset(a).GetHash()) < parentMapOld.setIndex(posetList.poset(b).GetHash());
                 });
-                if (false && tempVec.size() > 1000) {
-                    std::vector<std::thread> threads{};
-                    NCT::initThread();
-                    for (unsigned int i = 0; i < NCT::num_threads; i++) {
-                        threads.emplace_back([&,i] () {
-                            NCT::initThread();
-                            int begin = tempVec.size() * i / NCT::num_threads;
-                            int end = tempVec.size() * (i + 1) / NCT::num_threads;
-                            for (int id = begin; id < end; id++) {
-                                if (id == 0 || ((posetList[tempVec[id - 1]].GetHash() * MULT1) % size) != ((posetList[tempVec[id]].GetHash() * MULT1) % size)) {
-                                    parentMapOld.insert(posetList[tempVec[id]]);
-                                }
-                            }
-                        });
-                    }
-                    for (auto &thread: threads) {
-                        thread.join();
+                if (tempVec.size() > SearchParams::batchSize * 4 && NCT::num_threads > 1) {
+                    // every thread owns a range of sets, ranges are moved to the beginning of a set
+                    auto rangeBegin = [&](unsigned int t) {
+                        size_t id = tempVec.size() * t / NCT::num_threads;
+                        while (id > 0 && id < tempVec.size() &&
+                               parentMapOld.setIndex(posetList.poset(tempVec[id - 1]).GetHash()) ==
+                               parentMapOld.setIndex(posetList.poset(tempVec[id]).GetHash())) {
+                            id++;
+                        }
+                        return id;
+                    };
+                    std::vector<OldGenMap::InsertCounters> counters(NCT::num_threads);
+                    ThreadPool::run(NCT::num_threads, [&](ThreadPool::Worker &worker) {
+                        size_t end = rangeBegin(worker.id + 1);
+                        for (size_t id = rangeBegin(worker.id); id < end; id++) {
+                            parentMapOld.insert(posetList.withStatus(tempVec[id]), counters[worker.id]);
+                        }
+                    });
+                    for (auto &threadCounters: counters) {
+                        parentMapOld.mergeCounters(threadCounters);
                     }
                 } else {
                     for (auto id: tempVec) {
-                        parentMapOld.insert(posetList[id]);
+                        parentMapOld.insert(posetList.withStatus(id));
                     }
                 }
                 edgeList.resize(parentState.parentsBegin);
@@ -247,23 +284,32 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
     }
 
     if (parentState.phase == 0) {
+        // the states are online since the layer was created or processed in phase 2, the posets may have been spilled
+        profile.section(Section::FW_IO);
+        posetList.ensurePosetsOnlineFrom(parentState.posetListBegin);
+
         profile.section(Section::FW_PHASE1);
         tempVec.clear();
-        for (auto i = parentState.posetListBegin; i < parentState.posetListEnd; i++) {
-            if (posetList[i].isMarked()) {
-                tempVec.push_back(i);
+        collect(parentState.posetListBegin, parentState.posetListEnd, tempVec, [&](uint64_t i, std::vector<uint64_t> &buffer) {
+            if (posetList.state(i).isMarked()) {
+                buffer.push_back(i);
             }
-        }
+        });
 
         // sort
         __gnu_parallel::sort(tempVec.begin(), tempVec.end(), [&](uint64_t a, uint64_t b) {
-            return posetList[a].linExt < posetList[b].linExt;
+            return posetList.poset(a).linExt < posetList.poset(b).linExt;
         });
 
         profile.section(Section::FW_IO);
         edgeList.ensureOnlineAvailable(tempVec.size());
 
         profile.section(Section::FW_PHASE1);
+        ThreadPool::runRange(tempVec.size(), [&](ThreadPool::Worker &, size_t begin, size_t end) {
+            for (auto i = begin; i < end; i++) {
+                tempVec[i] = EdgeListWord::parent(tempVec[i], parentState.posetListBegin);
+            }
+        });
         parentState.parentsBegin = edgeList.size();
         edgeList.insert(tempVec.cbegin(), tempVec.cend());
         parentState.parentsEnd = edgeList.size();
@@ -276,12 +322,13 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
 
         Stats::inc(STAT::NPhase1);
 
-        std::atomic<size_t> parentIndex;
+        std::optional<WorkQueue> queue;
         unsigned int pOffset;
         unsigned int pMax;
+        std::atomic<uint64_t> oldLookups = 0;
+        std::atomic<uint64_t> oldHits = 0;
 
-        auto processFWThread = [&, childLayerCompleteAbove, parentC]() {
-            NCT::initThread();
+        auto processFWThread = [&, childLayerCompleteAbove, parentC](ThreadPool::Worker &worker) {
 
             enum ComparisonStatus {
                 SORTABLE,
@@ -297,16 +344,31 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                 ComparisonTuple(int kk1, int kk2, LinExtT l1, LinExtT l2, bool singleton) : k1(kk1), k2(kk2), lin1(l1), lin2(l2), singletonComp(singleton) {}
             };
 
-            LinearExtensionCalculator linExtCalculator{NCT::N, NCT::C};
+            // children of a comparison that need a lookup, created before their statuses are resolved
+            struct ComparisonChildren {
+                AnnotatedPosetObj first;
+                AnnotatedPosetObj second;
+                LinExtT lin1, lin2;
+                bool firstSortable, secondSortable;
+                // only the first child decides the comparison (isomorphic children or second child trivially sortable)
+                bool onlyFirst;
+            };
+
+            LinearExtensionCalculator &linExtCalculator = worker.linExtCalculator();
             std::vector<ComparisonTuple> comparisonVector;
-            std::vector<uint64_t> localEdgeList;
+            std::vector<ComparisonChildren> childBatch;
+            std::vector<EdgeListWord::Type> &localEdgeList = worker.edgeList;
+            // open comparisons in localEdgeList
+            size_t localComparisons = 0;
+            uint64_t localOldLookups = 0;
+            uint64_t localOldHits = 0;
 
             auto checkChild = [&, childLayerCompleteAbove, parentC](AnnotatedPosetObj &child, LinExtT linExt) {
 
                 if (linExt >= childLayerCompleteAbove) {
                     Stats::inc(STAT::NChildMapBWFind);
                     auto result = childMapBW.find(child);
-                    if (result == nullptr) {
+                    if (!result) {
                         return ComparisonStatus::UNSORTABLE;
                     } else if (result->GetStatus() == SortableStatus::NO) {
                         Stats::inc(STAT::NChildMapBWFindNo);
@@ -320,12 +382,14 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                     }
                 }
                 Stats::inc(STAT::NChildMapOldFind);
-                auto result = childMapOld.find(child);
-                if (result != nullptr) {
-                    if (result->GetStatus() == SortableStatus::NO) {
+                localOldLookups++;
+                auto oldStatus = childMapOld.find(child);
+                if (oldStatus != SortableStatus::UNFINISHED) {
+                    localOldHits++;
+                    if (oldStatus == SortableStatus::NO) {
                         Stats::inc(STAT::NChildMapOldFindNo);
                         return ComparisonStatus::UNSORTABLE;
-                    } else if (result->GetStatus() == SortableStatus::YES) {
+                    } else if (oldStatus == SortableStatus::YES) {
                         Stats::inc(STAT::NChildMapOldFindYes);
                         return ComparisonStatus::SORTABLE;
                     }
@@ -426,8 +490,8 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                 // find / insert
                 auto id = childMap.findAndInsert(child);
                 // edge list
-                localEdgeList.push_back(id);
-                localEdgeList.push_back(id);
+                localEdgeList.push_back(EdgeListWord::single(id, childLayerBegin));
+                localComparisons++;
             };
 
             auto createChildEntry = [&](AnnotatedPosetObj &first, AnnotatedPosetObj second) {
@@ -436,127 +500,169 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                 auto idFirst = childMap.findAndInsert(first);
                 auto idSecond = childMap.findAndInsert(second);
                 // edge list
-                localEdgeList.push_back(idFirst);
-                localEdgeList.push_back(idSecond);
+                localEdgeList.push_back(EdgeListWord::pair(idFirst, childLayerBegin));
+                localEdgeList.push_back(EdgeListWord::pair(idSecond, childLayerBegin));
+                localComparisons++;
             };
 
-            auto exploreComparison = [&, parentC](AnnotatedPosetObj &parentPoset, const ComparisonTuple &comparison) {
+            // creates the children of a comparison that are not trivially sortable, no lookups are done here
+            auto expandComparison = [&, parentC](AnnotatedPosetObj &parentPoset, const ComparisonTuple &comparison,
+                                                 ComparisonChildren &children) {
                 int k1 = comparison.k1;
                 int k2 = comparison.k2;
-                LinExtT lin1 = comparison.lin1;
-                LinExtT lin2 = comparison.lin2;
+                children.lin1 = comparison.lin1;
+                children.lin2 = comparison.lin2;
+                children.onlyFirst = false;
 
-                bool firstSortable = isEasilySortableLinExt(remainingComparisonsChild(parentC), lin1);
-                bool secondSortable = isEasilySortableLinExt(remainingComparisonsChild(parentC), lin2);
-                if (firstSortable && secondSortable) {
+                children.firstSortable = isEasilySortableLinExt(remainingComparisonsChild(parentC), children.lin1);
+                children.secondSortable = isEasilySortableLinExt(remainingComparisonsChild(parentC), children.lin2);
+                if (children.firstSortable && children.secondSortable) {
                     return ComparisonStatus::SORTABLE;
                 }
 
-                AnnotatedPosetObj firstChild;
                 PosetHandle handleParent{parentPoset, PosetInfo(parentPoset)};
-                if (!firstSortable) {
-                    ExpandedPosetChild new_poset_p1{handleParent, lin1, k1, k2};
-                    firstSortable = new_poset_p1.isEasilySortableUnrelatedPairs(remainingComparisonsChild(parentC));
+                if (!children.firstSortable) {
+                    ExpandedPosetChild new_poset_p1{handleParent, children.lin1, k1, k2};
+                    children.firstSortable = new_poset_p1.isEasilySortableUnrelatedPairs(remainingComparisonsChild(parentC));
 
-                    if (comparison.singletonComp || isEasilySortableLinExt(remainingComparisonsChild(parentC), lin2)) {
+                    if (comparison.singletonComp || children.secondSortable) {
                         // comparing two singletons, the two child posets are isomorphic, only need to check one; or
                         // second child is obviously sortable, only check first
-                        if (firstSortable) {
+                        if (children.firstSortable) {
                             return ComparisonStatus::SORTABLE;
                         }
-                        firstChild = new_poset_p1.getHandle();
-                        auto status = checkChild(firstChild, lin1);
-                        if (status != ComparisonStatus::INDETERMINATE) {
-                            return status;
-                        }
-                        createChildEntrySingleton(new_poset_p1.getHandle());
+                        children.first = new_poset_p1.getHandle();
+                        children.onlyFirst = true;
                         return ComparisonStatus::INDETERMINATE;
                     }
 
-                    if (firstSortable && secondSortable) {
+                    if (children.firstSortable && children.secondSortable) {
                         return ComparisonStatus::SORTABLE;
                     }
 
-                    if (!firstSortable) {
-                        firstChild = new_poset_p1.getHandle();
-                        auto status = checkChild(firstChild, lin1);
-                        if (status == ComparisonStatus::UNSORTABLE) {
-                            return status;
-                        } else if (status == ComparisonStatus::SORTABLE) {
-                            firstSortable = true;
-                        }
+                    if (!children.firstSortable) {
+                        children.first = new_poset_p1.getHandle();
                     }
+                }
 
-                    if (firstSortable && secondSortable) {
+                if (!children.secondSortable) {
+                    ExpandedPosetChild new_poset_p2{handleParent, children.lin2, k2, k1};
+                    children.secondSortable = new_poset_p2.isEasilySortableUnrelatedPairs(remainingComparisonsChild(parentC));
+
+                    if (children.firstSortable && children.secondSortable) {
                         return ComparisonStatus::SORTABLE;
                     }
+
+                    if (!children.secondSortable) {
+                        children.second = new_poset_p2.getHandle();
+                    }
                 }
+                return ComparisonStatus::INDETERMINATE;
+            };
 
-                AnnotatedPosetObj secondChild;
-                if (!secondSortable) {
-                    ExpandedPosetChild new_poset_p2{handleParent, lin2, k2, k1};
-                    secondSortable = new_poset_p2.isEasilySortableUnrelatedPairs(remainingComparisonsChild(parentC));
+            auto prefetchChild = [&, childLayerCompleteAbove](const AnnotatedPosetObj &child, LinExtT linExt) {
+                if (linExt >= childLayerCompleteAbove) {
+                    childMapBW.prefetch(child);
+                }
+                childMapOld.prefetch(child);
+            };
 
-                    if (firstSortable && secondSortable) {
-                        return ComparisonStatus::SORTABLE;
-                    }
+            // resolves the statuses of the children created by expandComparison
+            auto exploreComparison = [&](ComparisonChildren &children) {
+                bool firstSortable = children.firstSortable;
+                bool secondSortable = children.secondSortable;
 
-                    if (!secondSortable) {
-                        secondChild = new_poset_p2.getHandle();
-                        auto status = checkChild(secondChild, lin2);
-                        if (status == ComparisonStatus::UNSORTABLE) {
+                if (!firstSortable) {
+                    auto status = checkChild(children.first, children.lin1);
+                    if (children.onlyFirst) {
+                        if (status != ComparisonStatus::INDETERMINATE) {
                             return status;
-                        } else if (status == ComparisonStatus::SORTABLE) {
-                            secondSortable = true;
                         }
+                        createChildEntrySingleton(children.first);
+                        return ComparisonStatus::INDETERMINATE;
+                    }
+                    if (status == ComparisonStatus::UNSORTABLE) {
+                        return status;
+                    } else if (status == ComparisonStatus::SORTABLE) {
+                        firstSortable = true;
+                    }
+                }
+
+                if (!secondSortable) {
+                    auto status = checkChild(children.second, children.lin2);
+                    if (status == ComparisonStatus::UNSORTABLE) {
+                        return status;
+                    } else if (status == ComparisonStatus::SORTABLE) {
+                        secondSortable = true;
                     }
                 }
 
                 if (!firstSortable && !secondSortable) {
-                    createChildEntry(firstChild, secondChild);
+                    createChildEntry(children.first, children.second);
                 } else if (!firstSortable) {
-                    createChildEntrySingleton(firstChild);
+                    createChildEntrySingleton(children.first);
                 } else if (!secondSortable) {
-                    createChildEntrySingleton(secondChild);
+                    createChildEntrySingleton(children.second);
                 } else {
                     return ComparisonStatus::SORTABLE;
                 }
                 return ComparisonStatus::INDETERMINATE;
             };
 
-            auto processPoset = [&, parentC, limit](AnnotatedPosetObj &poset) {
+            auto processPoset = [&, parentC, limit](AnnotatedPosetObj &poset, PosetState &state) {
 
-                assert(poset.GetStatus() == SortableStatus::UNFINISHED);
+                assert(state.GetStatus() == SortableStatus::UNFINISHED);
 
                 comparisonVector.clear();
                 localEdgeList.clear();
                 localEdgeList.push_back(0);
+                localComparisons = 0;
 
                 PosetHandle handle{poset, PosetInfo(poset)};
                 LinExtT linExt = linExtCalculator.calculateLinExtensionsSingleton(handle, parentC, true, false);
 
                 if (linExt > limit * 2) {
                     Stats::inc(STAT::NParentUnsortableBWLimit);
-                    poset.SetUnsortable();
+                    state.SetUnsortable();
                     return;
                 }
 
                 enumerateComparisons(poset, limit);
 
+                // comparisons are handled in batches: create the children, prefetch their entries in the hash maps
+                // and resolve their statuses afterwards
                 bool unsortable = true;
-                for (const ComparisonTuple &item: comparisonVector) {
-                    ComparisonStatus status = exploreComparison(poset, item);
-                    if (status == ComparisonStatus::SORTABLE) {
-                        poset.SetSortable();
-                        poset.elIndex = -1;
-                        return;
-                    } else if (status == ComparisonStatus::INDETERMINATE) {
-                        unsortable = false;
+                for (size_t batchBegin = 0; batchBegin < comparisonVector.size(); batchBegin += SearchParams::lookupBatchSize) {
+                    size_t batchEnd = std::min(comparisonVector.size(), batchBegin + SearchParams::lookupBatchSize);
+                    childBatch.resize(batchEnd - batchBegin);
+                    for (size_t i = batchBegin; i < batchEnd; i++) {
+                        auto &children = childBatch[i - batchBegin];
+                        if (expandComparison(poset, comparisonVector[i], children) == ComparisonStatus::SORTABLE) {
+                            state.SetSortable();
+                            state.setElIndex(-1);
+                            return;
+                        }
+                        if (!children.firstSortable) {
+                            prefetchChild(children.first, children.lin1);
+                        }
+                        if (!children.secondSortable && !children.onlyFirst) {
+                            prefetchChild(children.second, children.lin2);
+                        }
+                    }
+                    for (auto &children: childBatch) {
+                        ComparisonStatus status = exploreComparison(children);
+                        if (status == ComparisonStatus::SORTABLE) {
+                            state.SetSortable();
+                            state.setElIndex(-1);
+                            return;
+                        } else if (status == ComparisonStatus::INDETERMINATE) {
+                            unsortable = false;
+                        }
                     }
                 }
 
                 if (unsortable) {
-                    poset.SetUnsortable();
+                    state.SetUnsortable();
                     return;
                 }
 
@@ -565,53 +671,71 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                 localEdgeList[0] = elSize;
                 auto index = edgeList.insert(localEdgeList.cbegin(), localEdgeList.cend());
                 assert(index >= parentState.elBegin);
-                poset.elIndex = index;
-                Stats::addVal<AVMSTAT::ELSizePhase1>(elSize / 2);
+                state.setElIndex(index);
+                Stats::addVal<AVMSTAT::ELSizePhase1>(localComparisons);
             };
 
-            while ((edgeList.size() - parentState.elBegin) < childEdgeLimit
-                   && (posetList.size() - parentState.posetListBegin) < childPosetLimit) {
-
-                // grab a batch of posets to process
-                size_t beginIndex = parentIndex.fetch_add(SearchParams::batchSize);
-                size_t endIndex = std::min((size_t) parentState.parentsEnd, beginIndex + SearchParams::batchSize);
-
-                // terminate if batch empty
-                if (endIndex <= beginIndex) {
-                    break;
+            // a chunk may use only a share of the remaining child limits, assuming every parent produces the most
+            // children possible. Each of the chunks in flight then stays within its share of the slack it saw when
+            // claimed, so together they end at the limits, plus at most one batch per worker from the minimum chunk size
+            auto maxChunk = [&]() -> size_t {
+                uint64_t edges = edgeList.size() - parentState.elBegin;
+                uint64_t posets = posetList.size() - parentState.posetListBegin;
+                if (edges >= childEdgeLimit || posets >= childPosetLimit) {
+                    return SearchParams::batchSize;
                 }
+                uint64_t byEdges = (childEdgeLimit - edges) / maxChildEdgesPerParent();
+                uint64_t byPosets = (childPosetLimit - posets) / maxChildPosetsPerParent();
+                return std::min(byEdges, byPosets) / NCT::num_threads;
+            };
 
-                // update progress
-                progress = static_cast<float>((parentIndex - parentState.parentsBegin)) / static_cast<float>(pMax);
+            size_t beginIndex;
+            size_t endIndex;
+            while ((edgeList.size() - parentState.elBegin) < childEdgeLimit
+                   && (posetList.size() - parentState.posetListBegin) < childPosetLimit
+                   && queue->claim(beginIndex, endIndex, maxChunk())) {
 
-                // process posets in batch
+                // process posets in chunk
                 for (size_t index = beginIndex; index < endIndex; index++) {
                     // get poset
-                    auto entryIdx = edgeList[index];
-                    auto &parent = posetList[entryIdx];
+                    auto entryIdx = EdgeListWord::parentIndex(edgeList[index], parentState.posetListBegin);
+                    auto &parent = posetList.state(entryIdx);
                     if (!parent.isMarked() || parent.GetStatus() != SortableStatus::UNFINISHED) {
                         continue;
                     }
                     // search
-                    processPoset(parent);
-                    assert(parent.GetStatus() != SortableStatus::UNFINISHED || parent.elIndex != 0 || parentC == 0);
+                    processPoset(posetList.poset(entryIdx), parent);
+                    assert(parent.GetStatus() != SortableStatus::UNFINISHED || parent.getElIndex() != 0 || parentC == 0);
+                }
+
+                // update progress
+                queue->finished(worker.id, endIndex - beginIndex);
+                if (worker.id == 0) {
+                    progress = static_cast<float>(pOffset + queue->done()) / static_cast<float>(pMax);
                 }
             }
 
+            oldLookups += localOldLookups;
+            oldHits += localOldHits;
             Stats::accumulate();
         };
 
         auto childListBegin = posetList.size();
+        assert(childListBegin == childLayerBegin);
         parentState.elBegin = edgeList.size();
 
         parentState.parentsSliceBegin = parentState.parentsSliceEnd;
 
         // io
         profile.section(Section::FW_IO);
-        posetList.ensureOnlineFrom(parentState.posetListBegin);
-        posetList.ensureOnlineAvailable(childPosetLimit + 50000); // magic number
+        // the two vectors use separate parts of the scratch file, their io can overlap
+        std::thread posetListIo([&]() {
+            posetList.ensureOnlineFrom(parentState.posetListBegin);
+            posetList.ensureOnlineAvailable(childPosetLimit + childPosetOvershoot());
+        });
         edgeList.ensureOnlineFrom(parentState.parentsSliceBegin);
-        edgeList.ensureOnlineAvailable(childEdgeLimit + 100000); // magic number
+        edgeList.ensureOnlineAvailable(childEdgeLimit + childEdgeOvershoot());
+        posetListIo.join();
 
         // process
         profile.section(Section::FW_PHASE1);
@@ -619,19 +743,14 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
         pMax = parentState.parentsEnd - parentState.parentsBegin;
         EventLog::write(true, "Processing layer c=" + std::to_string(parentC) +
                               " phase 1");
-        parentIndex = parentState.parentsSliceBegin;
-        if ((parentState.parentsEnd - parentState.parentsSliceBegin) > SearchParams::batchSize * 4) {
-            std::vector<std::thread> threads;
-            for (unsigned int i = 0; i < NCT::num_threads; i++) {
-                threads.emplace_back(processFWThread);
-            }
-            for (auto &thread: threads) {
-                thread.join();
-            }
-        } else {
-            processFWThread();
-        }
-        parentState.parentsSliceEnd = std::min(static_cast<uint64_t>(parentIndex), parentState.parentsEnd);
+        bool parallel = (parentState.parentsEnd - parentState.parentsSliceBegin) > SearchParams::batchSize * 4;
+        unsigned int numWorkers = parallel ? NCT::num_threads : 1;
+        queue.emplace(parentState.parentsSliceBegin, parentState.parentsEnd, numWorkers, SearchParams::batchSize);
+        ThreadPool::run(numWorkers, processFWThread);
+        // chunks are claimed in order, the claimed parents are the slice
+        parentState.parentsSliceEnd = queue->position();
+        childMapOld.lookups += oldLookups;
+        childMapOld.hits += oldHits;
 
         childMap.clear();
 
@@ -645,25 +764,33 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
             return;
         }
 
-        // mark posets
-        for (auto i = parentState.parentsSliceBegin; i < parentState.parentsSliceEnd; i++) {
-            auto &poset = posetList[edgeList[i]];
-            if (poset.isMarked() && poset.GetStatus() == SortableStatus::UNFINISHED) {
-                auto elIndex = poset.elIndex;
-                auto elSize = edgeList[elIndex];
-                for (int index = 1; index <= elSize; index += 2) {
-                    auto idFirst = edgeList[elIndex + index];
-                    auto idSecond = edgeList[elIndex + index + 1];
-                    // mark first, unless second is marked
-                    if (!posetList[idSecond].isMarked()) {
-                        if (!posetList[idFirst].isMarked()) {
-                            Stats::inc(STAT::NMarkFirst);
-                            posetList[idFirst].setMark(true);
+        // mark posets, children are shared between parents and marked atomically. Marks are only set, so at least one
+        // child of every comparison is marked, but which one depends on the order of the workers
+        ThreadPool::runRange(parentState.parentsSliceEnd - parentState.parentsSliceBegin, [&](ThreadPool::Worker &, size_t begin, size_t end) {
+            for (auto i = parentState.parentsSliceBegin + begin; i < parentState.parentsSliceBegin + end; i++) {
+                auto &poset = posetList.state(EdgeListWord::parentIndex(edgeList[i], parentState.posetListBegin));
+                if (poset.isMarked() && poset.GetStatus() == SortableStatus::UNFINISHED) {
+                    auto elIndex = poset.getElIndex();
+                    auto elSize = edgeList[elIndex];
+                    for (size_t index = 1; index <= elSize;) {
+                        auto word = edgeList[elIndex + index++];
+                        auto idFirst = EdgeListWord::childIndex(word, childLayerBegin);
+                        auto idSecond = idFirst;
+                        if (!EdgeListWord::isSingle(word)) {
+                            idSecond = EdgeListWord::childIndex(edgeList[elIndex + index++], childLayerBegin);
+                        }
+                        // mark first, unless second is marked
+                        if (!posetList.state(idSecond).isMarkedConcurrent()) {
+                            if (!posetList.state(idFirst).isMarkedConcurrent()) {
+                                Stats::inc(STAT::NMarkFirst);
+                                posetList.state(idFirst).markConcurrent();
+                            }
                         }
                     }
                 }
             }
-        }
+            Stats::accumulate();
+        });
 
         parentState.phase = 2;
         childState.posetListBegin = childListBegin;
@@ -674,7 +801,16 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
     }
 }
 
-void createInitialPosetFW(SemiOfflineVector<AnnotatedPosetObj> &posetList,
+// phase 1 may end one chunk of the minimum size per worker beyond the limits (see maxChunk in doForwardStep)
+uint64_t childPosetOvershoot() {
+    return std::max<uint64_t>(50000, static_cast<uint64_t>(NCT::num_threads) * SearchParams::batchSize * maxChildPosetsPerParent());
+}
+
+uint64_t childEdgeOvershoot() {
+    return std::max<uint64_t>(100000, static_cast<uint64_t>(NCT::num_threads) * SearchParams::batchSize * maxChildEdgesPerParent());
+}
+
+void createInitialPosetFW(PosetList &posetList,
                           LayerState &parentState) {
     PosetObj posetObj;
     posetObj.setMark(true);
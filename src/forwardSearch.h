@@ -32,6 +32,7 @@
 #include "posetInfo.h"
 #include "state.h"
 #include "oldGenMap.h"
+#include "edgeListWord.h"
 
 class PosetStorage;
 class TimeProfile;
@@ -40,11 +41,12 @@ class PosetMap;
 class PosetMapExt;
 template<class T>
 class SemiOfflineVector;
+class PosetList;
 class PosetEntry;
 
 
-void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
-                   SemiOfflineVector<uint64_t> &edgeList,
+void doForwardStep(PosetList &posetList,
+                   SemiOfflineVector<EdgeListWord::Type> &edgeList,
                    LayerState &parentState,
                    LayerState &childState,
                    unsigned int &parentC,
@@ -60,7 +62,15 @@ void doForwardStep(SemiOfflineVector<AnnotatedPosetObj> &posetList,
                    uint64_t childPosetLimit,
                    uint64_t childEdgeLimit);
 
-void createInitialPosetFW(SemiOfflineVector<AnnotatedPosetObj>& posetList,
+/**
+ * Upper bounds for the number of child posets and edge list words that doForwardStep may add beyond childPosetLimit
+ * and childEdgeLimit.
+ */
+uint64_t childPosetOvershoot();
+
+uint64_t childEdgeOvershoot();
+
+void createInitialPosetFW(PosetList& posetList,
                           LayerState &parentState);
 
 #endif //SORTINGLOWERBOUNDS_FORWARDSEARCH_H
@@ -100,4 +100,48 @@ bool boost_is_rev_isomorphic(const PosetObj& first, const PosetObj& second, unsi
     if (result)
         Stats::inc(STAT::NBoostIsoPositive);
     return result;
-}
\ No newline at end of file
+}
+
+bool isSamePoset(const AnnotatedPosetObj& candidate, const PosetObj& entry) {
+    Stats::inc(STAT::NEqualTest);
+
+    if (candidate.isUniqueGraph() != entry.isUniqueGraph() || candidate.GetSelfdualId() != entry.GetSelfdualId())
+    {
+        Stats::inc(STAT::NInPosetHashDiff);
+        return false;
+    }
+
+    Stats::inc(STAT::NIsoTest);
+    if (candidate.SameGraph(entry)){
+        Stats::inc(STAT::NIsoPositive);
+        assert(candidate.isUniqueGraph() == entry.isUniqueGraph());
+        return true;
+    }
+
+    return isIsomorphicPoset(candidate, entry);
+}
+
+bool isIsomorphicPoset(const AnnotatedPosetObj& candidate, const PosetObj& entry) {
+    //if the graph is unique and it does not agree bit-wise, we know that the graphs cannot be isomorphic
+    if (candidate.isUniqueGraph() && !candidate.GetSelfdualId())
+        return false;
+
+    unsigned int reduced_n = candidate.GetReducedN();
+    if(!entry.isSingletonsAbove(candidate.GetFirstSingleton())){
+        Stats::inc(STAT::NSingletonsDiff);
+        return false;
+    }
+
+    if(!entry.isPairs(reduced_n, candidate.GetNumPairs())){
+        Stats::inc(STAT::NPairsDiff);
+        return false;
+    }
+    if (candidate.GetSelfdualId())
+    {
+        if (boost_is_isomorphic(candidate, entry, reduced_n))
+            return true;
+        return boost_is_rev_isomorphic(candidate, entry, reduced_n);
+    }
+    else
+        return boost_is_isomorphic(candidate, entry, reduced_n);
+}
@@ -26,6 +26,7 @@
 #define SORTINGLOWERBOUNDS_ISOTEST_H
 
 class PosetObj;
+class AnnotatedPosetObj;
 
 /**
 * States wether the graphs of two PosetObjs are isomorphic.
@@ -45,4 +46,23 @@ bool boost_is_isomorphic(const PosetObj& first, const PosetObj& second, unsigned
 */
 bool boost_is_rev_isomorphic(const PosetObj& first, const PosetObj& second, unsigned int reduced_n);
 
+/**
+* States wether entry is the same poset as candidate up to isomorphism and reversal. Both must have the same hash.
+*
+* @param candidate The poset that is looked up
+* @param entry A stored poset
+* @return true iff the posets are equivalent
+*/
+bool isSamePoset(const AnnotatedPosetObj& candidate, const PosetObj& entry);
+
+/**
+* The part of isSamePoset after the graphs of candidate and entry were found to differ bit-wise. Both must have the
+* same hash, unique graph flag and selfdual id.
+*
+* @param candidate The poset that is looked up
+* @param entry A stored poset
+* @return true iff the posets are equivalent
+*/
+bool isIsomorphicPoset(const AnnotatedPosetObj& candidate, const PosetObj& entry);
+
 #endif //SORTINGLOWERBOUNDS_ISOTEST_H
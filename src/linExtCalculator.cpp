@@ -22,6 +22,7 @@
 // SOFTWARE.
 
 #include "linExtCalculator.h"
+#include "slabAllocator.h"
 
 #include <x86intrin.h>
 #include <iostream>
@@ -450,15 +451,15 @@ LinearExtensionCalculator::LinearExtensionCalculator(unsigned int N, unsigned in
     size_t newTempSize = pow(1.74, N + 4);
 
 #if LINEXT_TABLE_EXP
-    void* pointer = std::malloc(sizeof(UdSetItemFull)*(1ULL << MAXN));
-    void* pointer2 = std::malloc(sizeof(BitS)*newTempSize);
+    void* pointer = SlabAllocator::allocate(sizeof(UdSetItemFull)*(1ULL << MAXN));
+    void* pointer2 = SlabAllocator::allocate(sizeof(BitS)*newTempSize);
     internalCalcFull->allocatedMemorySize = newTempSize;
     internalCalc32->allocatedMemorySize = newTempSize;
 
     internalCalcFull->setPointer(pointer, pointer2);
     internalCalc32->setPointer(pointer, pointer2);
 #else
-    void* pointer = std::malloc(sizeof(UdSetItemFull)*newTempSize);
+    void* pointer = SlabAllocator::allocate(sizeof(UdSetItemFull)*newTempSize);
 	internalCalcFull->allocatedMemorySize = newTempSize;
 	internalCalc32->allocatedMemorySize = newTempSize;
 
@@ -588,9 +589,11 @@ LinExtT LinearExtensionCalculator::calculateLinExtensionsSingleton(PosetHandle &
 }
 
 LinearExtensionCalculator::~LinearExtensionCalculator() {
-    free(this->internalCalcFull->getPointer());
 #if LINEXT_TABLE_EXP
-    free(this->internalCalcFull->getPointer2());
+    SlabAllocator::deallocate(this->internalCalcFull->getPointer(), sizeof(UdSetItemFull)*(1ULL << MAXN));
+    SlabAllocator::deallocate(this->internalCalcFull->getPointer2(), sizeof(BitS)*this->internalCalcFull->allocatedMemorySize);
+#else
+    SlabAllocator::deallocate(this->internalCalcFull->getPointer(), sizeof(UdSetItemFull)*this->internalCalcFull->allocatedMemorySize);
 #endif
     delete this->internalCalcFull;
     delete this->internalCalc32;
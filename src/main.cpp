@@ -30,6 +30,8 @@
 #include "utils.h"
 #include "eventLog.h"
 #include "bidirSearch.h"
+#include "slabAllocator.h"
+#include "numaTopology.h"
 #include "tui.h"
 #include "posetAnalyser.h"
 
@@ -41,11 +43,17 @@ int main(int argc, char *argv[]) {
     std::string bw_path;
     std::string mmap_fast;
     std::string mmap_slow;
+    std::string oldgen_snapshot;
+    std::string scratch_backend;
+    std::string huge_pages;
     double activePosetMem;
     double oldPosetMem;
+    double bwParentMem;
     double effBandwidth;
     unsigned int fullLayers;
     bool reuse_bw;
+    bool bw_disk_layers;
+    bool bw_compress;
 
     // Declare the supported options.
     po::options_description desc("Allowed options");
@@ -65,14 +73,21 @@ int main(int argc, char *argv[]) {
             ("eff-bandwidth", po::value<double>(&effBandwidth)->default_value(0.125), "set efficiency bandwidth for bidir search")
             ("full-layers", po::value<unsigned int>(&fullLayers)->default_value(10), "set full bw layers for bidir search")
             ("reuse-bw", po::value<bool>(&reuse_bw)->default_value(true), "set whether to reuse bw search results from previous runs")
+            ("bw-disk-layers", po::value<bool>(&bw_disk_layers)->default_value(false), "look up bw layers in their files instead of loading them into RAM, bidir search only")
+            ("bw-compress", po::value<bool>(&bw_compress)->default_value(true), "store bw layers compressed (not with bw-disk-layers)")
 
             ("log-path", po::value<std::string>(&log_path)->default_value("./outputs"), "set directory for log files")
             ("bw-path", po::value<std::string>(&bw_path)->default_value("./storageBw"), "set directory for backward search storage")
             ("tempfile-fast", po::value<std::string>(&mmap_fast)->default_value("./temp_fast.mmap"), "fast temp storage file (ssd), fw search only")
             ("tempfile-slow", po::value<std::string>(&mmap_slow)->default_value("./temp_slow.mmap"), "slow temp storage file (hdd), fw search only")
+            ("scratch-backend", po::value<std::string>(&scratch_backend)->default_value("mmap"), "io for spilled posets in the slow temp storage: mmap or direct (O_DIRECT), fw search only")
+            ("oldgen-snapshot", po::value<std::string>(&oldgen_snapshot)->default_value(""), "directory to load/store old gen map snapshots (empty: disabled), fw search only")
 
+            ("numa", po::value<bool>(&NumaTopology::enabled)->default_value(true), "pin workers to NUMA nodes and interleave large buffers over the nodes")
+            ("huge-pages", po::value<std::string>(&huge_pages)->default_value("transparent"), "huge pages for large buffers: none, transparent (madvise) or explicit (MAP_HUGETLB)")
             ("active-poset-mem", po::value<double>(&activePosetMem)->default_value(0.25), "Memory (RAM) for active posets in Gb")
             ("old-poset-mem", po::value<double>(&oldPosetMem)->default_value(0.25), "Memory (RAM) for old posets in Gb")
+            ("bw-parent-mem", po::value<double>(&bwParentMem)->default_value(4), "Memory (RAM) for the parents of a bw step in Gb, more are written to shards on disk")
             ;
 
     po::variables_map vm;
@@ -100,6 +115,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (scratch_backend != "mmap" && scratch_backend != "direct") {
+        std::cerr << "Unknown scratch backend " << scratch_backend << ", use mmap or direct." << std::endl;
+        return 1;
+    }
+
+    if (huge_pages == "none") {
+        SlabAllocator::hugePages = SlabAllocator::HugePages::NONE;
+    } else if (huge_pages == "transparent") {
+        SlabAllocator::hugePages = SlabAllocator::HugePages::TRANSPARENT;
+    } else if (huge_pages == "explicit") {
+        SlabAllocator::hugePages = SlabAllocator::HugePages::EXPLICIT;
+    } else {
+        std::cerr << "Unknown huge page mode " << huge_pages << ", use none, transparent or explicit." << std::endl;
+        return 1;
+    }
+
     if (vm.count("interactive")) {
         if (isTuiSupported()) {
             tuiLoop(log_path);
@@ -121,6 +152,8 @@ int main(int argc, char *argv[]) {
     EventLog::init(&outputStream, &outputStreamEvents);
     EventLog::writeCout = true;
 
+    NumaTopology::init();
+
     assert(NCT::N <= MAXN);
 
     Search search{};
@@ -147,13 +180,18 @@ int main(int argc, char *argv[]) {
 
     search.scratchFast = mmap_fast;
     search.scratchMedium = mmap_slow;
+    search.scratchDirectIo = scratch_backend == "direct";
+    search.oldGenSnapshotPath = oldgen_snapshot;
 
     search.effBandwidth = effBandwidth;
     search.fullLayers = fullLayers;
     search.reuse_bw = reuse_bw;
+    search.bwDiskLayers = bw_disk_layers;
+    search.bwCompress = bw_compress;
 
     search.activePosetMemory = uint64_t(activePosetMem * 1024) << 20;
     search.oldGenMemory = uint64_t(oldPosetMem * 1024) << 20;
+    search.bwParentMemory = uint64_t(bwParentMem * 1024) << 20;
 
     search.run();
     //analysePosets(storage);
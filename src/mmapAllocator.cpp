@@ -52,20 +52,19 @@ void MmapAllocator::returnMemory(PosetObj *ptr, uint32_t num) {
     std::lock_guard lck(allocatorMutex);
     assert(ptr != nullptr);
     assert(num > 0);
-    freeMemoryList.emplace_back(ptr, num);
+    freeMemoryLists[num].push_back(ptr);
 }
 
 PosetObj *MmapAllocator::requestMemory(uint32_t sizeRequest) {
     std::lock_guard lck(allocatorMutex);
     assert(sizeRequest < numTperFile/4);
 
-    for (auto freeMemIter = freeMemoryList.begin(); freeMemIter != freeMemoryList.end() ; freeMemIter++) {
-        if (freeMemIter->size == sizeRequest) {
-            PosetObj* result = freeMemIter->start;
-            freeMemoryList.erase(freeMemIter);
-            assert(result != nullptr);
-            return result;
-        }
+    auto freeList = freeMemoryLists.find(sizeRequest);
+    if (freeList != freeMemoryLists.end() && !freeList->second.empty()) {
+        PosetObj* result = freeList->second.back();
+        freeList->second.pop_back();
+        assert(result != nullptr);
+        return result;
     }
 
 
@@ -96,30 +95,7 @@ char *MmapAllocator::allocateMmapFile(unsigned int newSize) {
 
     const uint64_t numChars = newSize * sizeof(PosetObj);
 
-    FILE *pFile = fopen (filename, "w");
-
-    if (pFile == nullptr)
-    {
-        EventLog::write(true, "could not open file " + filenameS);
-        return nullptr;
-    }
-
-    fseek ( pFile , numChars - 1 , SEEK_SET );
-
-    char x = 's';
-
-    fwrite ( &x , sizeof(char), 1, pFile);
-
-    if (ferror (pFile))
-    {
-        EventLog::write(true, "error when writing file " + filenameS);
-        return nullptr;
-    }
-
-    fclose (pFile);
-
-
-    auto fd = open(filename, O_RDWR);
+    auto fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
     if (fd == -1) {
         EventLog::write(true, "mmap file open error: " + filenameS);
         return nullptr;
@@ -127,6 +103,13 @@ char *MmapAllocator::allocateMmapFile(unsigned int newSize) {
         EventLog::write(true, "mmap file open success: " + filenameS);
     }
 
+    // sparse file of the requested size
+    if (ftruncate(fd, static_cast<off_t>(numChars)) != 0) {
+        EventLog::write(true, "error when resizing file " + filenameS);
+        close(fd);
+        return nullptr;
+    }
+
 
     char* mmapPtr = (char*)mmap(nullptr, numChars, PROT_READ | PROT_WRITE, MAP_NORESERVE | MAP_SHARED, fd, 0);  //MAP_PRIVATE
 
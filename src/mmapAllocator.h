@@ -27,7 +27,7 @@
 #include <vector>
 #include <string>
 #include <mutex>
-#include <list>
+#include <unordered_map>
 
 class PosetObj;
 
@@ -49,14 +49,8 @@ private:
 	std::mutex allocatorMutex;
 
 
-    struct FreeMemoryListItem {
-        PosetObj* start;
-        uint32_t size;
-        FreeMemoryListItem(PosetObj* ptr, uint32_t num) : start(ptr), size(num) {}
-        FreeMemoryListItem() : start(nullptr), size(0) {}
-    };
-
-    std::list<FreeMemoryListItem> freeMemoryList;
+    // returned blocks by size, blocks are only reused for requests of the same size
+    std::unordered_map<uint32_t, std::vector<PosetObj*>> freeMemoryLists;
 
 public:
 
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <mutex>
+#include <optional>
 
 #include "posetObj.h"
 #include "stats.h"
@@ -93,6 +94,10 @@ public:
 		loadFactor = computeLoadFactor(capacity);
     }
 
+	[[nodiscard]] uint64_t memoryBytes() const {
+		return capacity * sizeof(Ptr);
+	}
+
 	void clear() {
 		this->gen += 1;
 		if (this->gen >= Ptr::posetGenMAX) {
@@ -103,9 +108,9 @@ public:
 	}
 
 	/**
-	 * Find a poset in the hash map. Returns nullptr if not found.
+	 * Find a poset in the hash map. Returns an empty optional if not found.
 	 */
-	PosetObj* find(AnnotatedPosetObj& candidate) {
+	std::optional<PosetObj> find(AnnotatedPosetObj& candidate) {
 		std::lock_guard<std::mutex> lock{mutex};
 
 		assert(capacity != 0);
@@ -120,9 +125,8 @@ public:
 			Ptr& entryPtr = data[index];
 			if (testEquality(candidate, entryPtr))
 			{
-				PosetObj& entry = container.get(entryPtr.GetPosetRefIndex());
 				Stats::addVal<AVMSTAT::HFindGlobNStepsPos>(i + 1);
-				return &entry;
+				return container.get(entryPtr.GetPosetRefIndex());
 			}
 			i++;
 
@@ -130,7 +134,7 @@ public:
 			if (i>= capacity){
 				assert(i == capacity);
 				std::cout << "i>= capacity. i:" << i << " capacity: " << capacity << " num_elements: " << numElements << std::endl << std::endl;
-				return nullptr;
+				return std::nullopt;
 			}
 
 			assert(i < capacity);
@@ -140,7 +144,14 @@ public:
 			DEBUG_ASSERT(index < capacity);
 		}
 		Stats::addVal<AVMSTAT::HFindGlobNStepsNeg>(i);
-		return nullptr;
+		return std::nullopt;
+	}
+
+	/**
+	 * Prefetch the first probe of a later find. Does not lock, the hash map must not be modified concurrently.
+	 */
+	void prefetch(const AnnotatedPosetObj& candidate) const {
+		__builtin_prefetch(&data[candidate.GetHash() % capacity]);
 	}
 
 	/**
@@ -148,7 +159,14 @@ public:
 	 */
 	uint64_t findAndInsert(const AnnotatedPosetObj& candidate) {
 		std::lock_guard<std::mutex> lock{mutex};
+		return findAndInsertExclusive(candidate);
+	}
 
+	/**
+	 * Same as findAndInsert, but does not lock the hash map. The caller must guarantee that no other thread accesses the
+	 * hash map concurrently, e.g. by assigning each hash map to exactly one thread during a bulk insert.
+	 */
+	uint64_t findAndInsertExclusive(const AnnotatedPosetObj& candidate) {
 		beginning:
 		assert(capacity != 0);
 
@@ -222,7 +240,7 @@ private:
 			if (pointer.isValid(gen)) {
 				count++;
 				std::size_t i = 0;
-				PosetObj &poset = container.get(pointer.GetPosetRefIndex());
+				auto poset = container.get(pointer.GetPosetRefIndex());
 				PosetHandleFull currentHandle = PosetHandleFull::fromPoset(poset);
 				std::size_t index = currentHandle.GetHash() % capacity;
 				while (temp[index].isValid(gen)) {
@@ -249,44 +267,8 @@ private:
 		}
 
 		// check equality
-		auto& entry = container.get(entryPointer.GetPosetRefIndex());
-		Stats::inc(STAT::NEqualTest);
-
-		if (candidate.isUniqueGraph() != entry.isUniqueGraph() || candidate.GetSelfdualId() != entry.GetSelfdualId())
-		{
-			Stats::inc(STAT::NInPosetHashDiff);
-			return false;
-		}
-
-		Stats::inc(STAT::NIsoTest);
-		if (candidate.SameGraph(entry)){
-			Stats::inc(NIsoPositive);
-			assert(candidate.isUniqueGraph() == entry.isUniqueGraph());
-			return true;
-		}
-
-		//if the graph is unique and it does not agree bit-wise, we know that the graphs cannot be isomorphic
-		if (candidate.isUniqueGraph() && !candidate.GetSelfdualId())
-			return false;
-
-		unsigned int reduced_n = candidate.GetReducedN();
-		if(!entry.isSingletonsAbove(candidate.GetFirstSingleton())){
-			Stats::inc(STAT::NSingletonsDiff);
-			return false;
-		}
-
-		if(!entry.isPairs(reduced_n, candidate.GetNumPairs())){
-			Stats::inc(STAT::NPairsDiff);
-			return false;
-		}
-		if (candidate.GetSelfdualId())
-		{
-			if (boost_is_isomorphic(candidate, entry, reduced_n))
-				return true;
-			return boost_is_rev_isomorphic(candidate, entry, reduced_n);
-		}
-		else
-			return boost_is_isomorphic(candidate, entry, reduced_n);
+		const auto& entry = container.get(entryPointer.GetPosetRefIndex());
+		return isSamePoset(candidate, entry);
 	}
 	
 };
@@ -0,0 +1,124 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+#include "numaTopology.h"
+#include "eventLog.h"
+
+namespace {
+    // from linux/mempolicy.h
+    constexpr int mpolInterleave = 3;
+
+    /**
+     * Parses a sysfs cpu list like "0-15,32-47".
+     */
+    std::vector<unsigned int> parseCpuList(const std::string &list) {
+        std::vector<unsigned int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || range == "\n") {
+                continue;
+            }
+            auto dash = range.find('-');
+            unsigned int first = std::stoul(range.substr(0, dash));
+            unsigned int last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (unsigned int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+}
+
+std::vector<NumaTopology::Node> NumaTopology::nodes;
+bool NumaTopology::enabled = true;
+
+void NumaTopology::init() {
+    nodes.clear();
+    const std::filesystem::path root = "/sys/devices/system/node";
+    std::error_code error;
+    for (const auto &entry: std::filesystem::directory_iterator(root, error)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::isdigit(name[4])) {
+            continue;
+        }
+        std::ifstream cpuList(entry.path() / "cpulist");
+        std::string list;
+        std::getline(cpuList, list);
+        auto cpus = parseCpuList(list);
+        if (!cpus.empty()) {
+            nodes.push_back(Node{static_cast<unsigned int>(std::stoul(name.substr(4))), cpus});
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node &a, const Node &b) {
+        return a.id < b.id;
+    });
+    EventLog::write(false, "NUMA nodes: " + std::to_string(numNodes()) +
+                           (numNodes() > 1 && enabled ? ", pinning workers and interleaving buffers" : ""));
+}
+
+size_t NumaTopology::numNodes() {
+    return std::max(nodes.size(), size_t(1));
+}
+
+void NumaTopology::pinWorker(unsigned int workerId) {
+    if (!enabled || nodes.size() <= 1) {
+        return;
+    }
+    const auto &node = nodes[workerId % nodes.size()];
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu: node.cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+}
+
+void NumaTopology::interleave(void *ptr, size_t bytes) {
+    if (!enabled || nodes.size() <= 1) {
+        return;
+    }
+    constexpr size_t bitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(nodes.back().id / bitsPerWord + 1, 0);
+    for (const auto &node: nodes) {
+        nodeMask[node.id / bitsPerWord] |= 1UL << (node.id % bitsPerWord);
+    }
+    // without libnuma, the kernel expects the mask size in bits plus one
+    if (syscall(SYS_mbind, ptr, bytes, mpolInterleave, nodeMask.data(), nodeMask.size() * bitsPerWord + 1, 0) != 0) {
+        static bool warned = false;
+        if (!warned) {
+            warned = true;
+            EventLog::write(true, "mbind failed, memory is placed on first touch");
+        }
+    }
+}
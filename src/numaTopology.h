@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_NUMATOPOLOGY_H
+#define SORTINGLOWERBOUNDS_NUMATOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * NUMA nodes of the machine as reported by sysfs. On machines with more than one node the workers of the searches are
+ * pinned round robin to the cpus of a node and the large shared buffers are interleaved over all nodes, so hash map
+ * probes are spread evenly instead of hitting the node of the thread that touched the memory first.
+ */
+class NumaTopology {
+    struct Node {
+        unsigned int id;
+        std::vector<unsigned int> cpus;
+    };
+
+    static std::vector<Node> nodes;
+
+public:
+    static bool enabled;
+
+    static void init();
+
+    [[nodiscard]] static size_t numNodes();
+
+    /**
+     * Pins the calling thread to the cpus of node workerId % numNodes().
+     */
+    static void pinWorker(unsigned int workerId);
+
+    /**
+     * Sets an interleaved memory policy on a fresh mapping, has to be called before the memory is touched.
+     */
+    static void interleave(void *ptr, size_t bytes);
+};
+
+#endif //SORTINGLOWERBOUNDS_NUMATOPOLOGY_H
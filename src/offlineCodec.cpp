@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "offlineCodec.h"
+#include "posetCode.h"
+
+namespace {
+    const PosetCode &fullCode() {
+        static const PosetCode code{MAXENDC};
+        return code;
+    }
+}
+
+size_t OfflineCodec<AnnotatedPosetObj>::maxEncodedBytes(size_t count) {
+    return count * (fullCode().slotBytes() + sizeof(uint64_t) + varint::maxBytes<LinExtT>());
+}
+
+size_t OfflineCodec<AnnotatedPosetObj>::encode(const AnnotatedPosetObj *src, size_t count, uint8_t *dst) {
+    const auto &code = fullCode();
+    uint8_t *pos = dst;
+    for (size_t i = 0; i < count; i++) {
+        const auto &poset = src[i];
+        bool encoded = code.encode(poset, pos);
+        assert(encoded);
+        pos += code.slotBytes();
+        if (!poset.isUniqueGraph()) {
+            uint64_t hash = poset.GetHash();
+            memcpy(pos, &hash, sizeof(hash));
+            pos += sizeof(hash);
+        }
+        pos = varint::write(poset.linExt, pos);
+    }
+    return pos - dst;
+}
+
+void OfflineCodec<AnnotatedPosetObj>::decode(const uint8_t *src, size_t count, AnnotatedPosetObj *dst) {
+    const auto &code = fullCode();
+    for (size_t i = 0; i < count; i++) {
+        PosetObj poset;
+        code.decode(src, poset);
+        src += code.slotBytes();
+        uint64_t hash;
+        if (poset.isUniqueGraph()) {
+            hash = poset.computeHash();
+        } else {
+            memcpy(&hash, src, sizeof(hash));
+            src += sizeof(hash);
+        }
+        LinExtT linExt;
+        src = varint::read(src, linExt);
+        dst[i] = AnnotatedPosetObj{poset, PosetInfoFull(PosetInfo::fromPoset(poset), hash), linExt};
+    }
+}
@@ -0,0 +1,138 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_OFFLINECODEC_H
+#define SORTINGLOWERBOUNDS_OFFLINECODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "posetObj.h"
+
+namespace varint {
+
+    template<typename Int>
+    inline uint8_t *write(Int value, uint8_t *dst) {
+        while (value >= 0x80) {
+            *dst++ = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        *dst++ = static_cast<uint8_t>(value);
+        return dst;
+    }
+
+    template<typename Int>
+    inline const uint8_t *read(const uint8_t *src, Int &value) {
+        value = 0;
+        unsigned int shift = 0;
+        while (*src & 0x80) {
+            value |= static_cast<Int>(*src++ & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= static_cast<Int>(*src++) << shift;
+        return src;
+    }
+
+    // bytes required for a value of type Int in the worst case
+    template<typename Int>
+    constexpr size_t maxBytes() {
+        return (sizeof(Int) * 8 + 6) / 7;
+    }
+}
+
+/**
+ * Encoding of blocks of elements for the offline part of SemiOfflineVector. Blocks are decoded sequentially, so
+ * decoding fewer elements than were encoded yields a prefix of the block. The default stores elements as they are.
+ */
+template<class T>
+struct OfflineCodec {
+    static size_t maxEncodedBytes(size_t count) {
+        return count * sizeof(T);
+    }
+
+    static size_t encode(const T *src, size_t count, uint8_t *dst) {
+        memcpy(dst, src, count * sizeof(T));
+        return count * sizeof(T);
+    }
+
+    static void decode(const uint8_t *src, size_t count, T *dst) {
+        memcpy(dst, src, count * sizeof(T));
+    }
+};
+
+/**
+ * Edge lists consist of poset indices that are mostly increasing and of small list sizes, stored as zigzag deltas.
+ */
+template<class Int>
+struct DeltaOfflineCodec {
+    static size_t maxEncodedBytes(size_t count) {
+        return count * varint::maxBytes<Int>();
+    }
+
+    static size_t encode(const Int *src, size_t count, uint8_t *dst) {
+        typedef std::make_signed_t<Int> SignedInt;
+        uint8_t *pos = dst;
+        Int prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            auto delta = static_cast<SignedInt>(src[i] - prev);
+            pos = varint::write(static_cast<Int>(static_cast<Int>(delta) << 1) ^
+                                static_cast<Int>(delta >> (sizeof(Int) * 8 - 1)), pos);
+            prev = src[i];
+        }
+        return pos - dst;
+    }
+
+    static void decode(const uint8_t *src, size_t count, Int *dst) {
+        Int prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            Int zigzag;
+            src = varint::read(src, zigzag);
+            prev += (zigzag >> 1) ^ static_cast<Int>(~(zigzag & 1) + 1);
+            dst[i] = prev;
+        }
+    }
+};
+
+template<>
+struct OfflineCodec<uint32_t> : DeltaOfflineCodec<uint32_t> {
+};
+
+template<>
+struct OfflineCodec<uint64_t> : DeltaOfflineCodec<uint64_t> {
+};
+
+/**
+ * Posets are stored in the encoding of PosetCode. PosetInfo is recomputed on decode, as is the hash of posets with a
+ * unique graph. Only the hash of the other posets is stored, since recomputing it is expensive.
+ */
+template<>
+struct OfflineCodec<AnnotatedPosetObj> {
+    static size_t maxEncodedBytes(size_t count);
+
+    static size_t encode(const AnnotatedPosetObj *src, size_t count, uint8_t *dst);
+
+    static void decode(const uint8_t *src, size_t count, AnnotatedPosetObj *dst);
+};
+
+#endif //SORTINGLOWERBOUNDS_OFFLINECODEC_H
@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+
+#include "eventLog.h"
+#include "offlineStorage.h"
+
+MmapOfflineStorage::MmapOfflineStorage(boost::interprocess::managed_mapped_file::segment_manager *segment_manager)
+        : segment_manager(segment_manager) {
+}
+
+MmapOfflineStorage::~MmapOfflineStorage() {
+    if (bytes != nullptr) {
+        segment_manager->deallocate(bytes);
+    }
+}
+
+void MmapOfflineStorage::reserve(size_t capacity) {
+    assert(bytes == nullptr);
+    bytes = static_cast<uint8_t *>(segment_manager->allocate(capacity));
+}
+
+void MmapOfflineStorage::write(size_t offset, const uint8_t *src, size_t length) {
+    memcpy(bytes + offset, src, length);
+}
+
+void MmapOfflineStorage::read(size_t offset, uint8_t *dst, size_t length) {
+    memcpy(dst, bytes + offset, length);
+}
+
+DirectFileOfflineStorage::DirectFileOfflineStorage(std::string path) : path(std::move(path)) {
+    fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (fd == -1) {
+        EventLog::write(true, "O_DIRECT not available for " + this->path + " (" + strerror(errno) + "), using buffered io");
+        fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd == -1) {
+        EventLog::write(true, "could not open scratch file " + this->path + ": " + strerror(errno));
+    }
+    assert(fd != -1);
+}
+
+DirectFileOfflineStorage::~DirectFileOfflineStorage() {
+    close(fd);
+    std::remove(path.c_str());
+}
+
+void DirectFileOfflineStorage::reserve(size_t capacity) {
+    if (ftruncate(fd, static_cast<off_t>((capacity + blockSize - 1) / blockSize * blockSize)) != 0) {
+        EventLog::write(true, "could not reserve " + std::to_string(capacity) + " bytes in " + path);
+    }
+}
+
+void DirectFileOfflineStorage::write(size_t offset, const uint8_t *src, size_t length) {
+    assert(offset % blockSize == 0 && length % blockSize == 0);
+    while (length > 0) {
+        ssize_t written = pwrite(fd, src, length, static_cast<off_t>(offset));
+        if (written <= 0) {
+            if (written == -1 && errno == EINTR) {
+                continue;
+            }
+            EventLog::write(true, "write to scratch file " + path + " failed: " + strerror(errno));
+            assert(false);
+            return;
+        }
+        src += written;
+        offset += written;
+        length -= written;
+    }
+}
+
+void DirectFileOfflineStorage::read(size_t offset, uint8_t *dst, size_t length) {
+    assert(offset % blockSize == 0 && length % blockSize == 0);
+    while (length > 0) {
+        ssize_t bytesRead = pread(fd, dst, length, static_cast<off_t>(offset));
+        if (bytesRead <= 0) {
+            if (bytesRead == -1 && errno == EINTR) {
+                continue;
+            }
+            EventLog::write(true, "read from scratch file " + path + " failed: " + strerror(errno));
+            assert(false);
+            return;
+        }
+        dst += bytesRead;
+        offset += bytesRead;
+        length -= bytesRead;
+    }
+}
@@ -0,0 +1,101 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_OFFLINESTORAGE_H
+#define SORTINGLOWERBOUNDS_OFFLINESTORAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <boost/interprocess/managed_mapped_file.hpp>
+
+/**
+ * Backing store for the offline part of a SemiOfflineVector. Offsets and lengths passed to read and write have to be
+ * multiples of alignment(), buffers have to be aligned to it as well.
+ */
+class OfflineStorage {
+public:
+    virtual ~OfflineStorage() = default;
+
+    [[nodiscard]] virtual size_t alignment() const = 0;
+
+    /**
+     * Called once by the owner before the first write with the number of bytes it will use at most.
+     */
+    virtual void reserve(size_t capacity) = 0;
+
+    virtual void write(size_t offset, const uint8_t *src, size_t length) = 0;
+
+    virtual void read(size_t offset, uint8_t *dst, size_t length) = 0;
+};
+
+/**
+ * Offline storage in a region of a memory mapped file, the page cache decides what is written back.
+ */
+class MmapOfflineStorage : public OfflineStorage {
+    boost::interprocess::managed_mapped_file::segment_manager *const segment_manager;
+    uint8_t *bytes = nullptr;
+
+public:
+    explicit MmapOfflineStorage(boost::interprocess::managed_mapped_file::segment_manager *segment_manager);
+
+    ~MmapOfflineStorage() override;
+
+    [[nodiscard]] size_t alignment() const override {
+        return 1;
+    }
+
+    void reserve(size_t capacity) override;
+
+    void write(size_t offset, const uint8_t *src, size_t length) override;
+
+    void read(size_t offset, uint8_t *dst, size_t length) override;
+};
+
+/**
+ * Offline storage in a file opened with O_DIRECT, spills bypass the page cache and do not compete with the online
+ * data for memory. Falls back to buffered I/O if the file system does not support O_DIRECT.
+ */
+class DirectFileOfflineStorage : public OfflineStorage {
+    static constexpr size_t blockSize = 4096;
+
+    const std::string path;
+    int fd;
+
+public:
+    explicit DirectFileOfflineStorage(std::string path);
+
+    ~DirectFileOfflineStorage() override;
+
+    [[nodiscard]] size_t alignment() const override {
+        return blockSize;
+    }
+
+    void reserve(size_t capacity) override;
+
+    void write(size_t offset, const uint8_t *src, size_t length) override;
+
+    void read(size_t offset, uint8_t *dst, size_t length) override;
+};
+
+#endif //SORTINGLOWERBOUNDS_OFFLINESTORAGE_H
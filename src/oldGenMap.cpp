@@ -23,99 +23,258 @@
 
 
 #include <cstdlib>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
 
 #include "oldGenMap.h"
 #include "stats.h"
 #include "isoTest.h"
+#include "posetHandle.h"
+#include "slabAllocator.h"
 #include <boost/interprocess/allocators/allocator.hpp>
 
-OldGenMap::OldGenMap(boost::interprocess::managed_mapped_file::segment_manager *segment_manager, size_t size) :
-size(size),
+OldGenMap::OldGenMap(boost::interprocess::managed_mapped_file::segment_manager *segment_manager, size_t size,
+                     unsigned int layer) :
+numSets(std::max(size / ways, size_t(1))),
+size(std::max(size / ways, size_t(1)) * ways),
 segment_manager(segment_manager),
-empty(true) {
-    posetArray = static_cast<PosetObj*>(segment_manager->allocate(sizeof(PosetObj) * size));
-    hashArray = static_cast<uint16_t*>(malloc(sizeof(uint16_t) * size));
-    for (size_t i = 0; i < size; i++) {
-        hashArray[i] = ((1u << 16) - 1);
+layer(layer),
+code(layer),
+slotBytes(code.slotBytes()),
+empty(true),
+evictions(0),
+rejections(0),
+lookups(0),
+hits(0) {
+    codeArray = static_cast<uint8_t*>(segment_manager->allocate(slotBytes * this->size));
+    hashArray = static_cast<uint16_t*>(SlabAllocator::allocate(sizeof(uint16_t) * this->size));
+    metaArray = static_cast<uint8_t*>(SlabAllocator::allocate(sizeof(uint8_t) * this->size));
+    for (size_t i = 0; i < this->size; i++) {
+        hashArray[i] = emptyTag;
+        metaArray[i] = 0;
     }
     profile.fill(0);
     profileStorage.fill(0);
 }
 
 OldGenMap::~OldGenMap() {
-    free(hashArray);
-    segment_manager->deallocate(posetArray);
+    SlabAllocator::deallocate(hashArray, sizeof(uint16_t) * size);
+    SlabAllocator::deallocate(metaArray, sizeof(uint8_t) * size);
+    segment_manager->deallocate(codeArray);
+}
+
+uint8_t OldGenMap::createMeta(const AnnotatedPosetObj &poset) {
+    // cost: log2 of the number of linear extensions
+    unsigned int cost = 0;
+    LinExtT linExt = poset.linExt;
+    while (linExt > 1 && cost < (0xFFu >> metaCostShift)) {
+        linExt >>= 1;
+        cost++;
+    }
+    return (cost << metaCostShift) | poset.GetStatus();
 }
 
 void OldGenMap::insert(const AnnotatedPosetObj& poset) {
-    profile[poset.GetStatus()]++;
+    InsertCounters counters;
+    insert(poset, counters);
+    mergeCounters(counters);
+}
+
+void OldGenMap::mergeCounters(const InsertCounters &counters) {
+    for (size_t i = 0; i < profile.size(); i++) {
+        profile[i] += counters.profile[i];
+        profileStorage[i] += counters.profileStorage[i];
+        if (counters.profile[i] > 0) {
+            empty = false;
+        }
+    }
+    evictions += counters.evictions;
+    rejections += counters.rejections;
+}
 
-    uint64_t index = (poset.GetHash() * MULT1) % size;
-    uint16_t hash = (poset.GetHash() * MULT2) % ((1u << 16) - 1);
+void OldGenMap::insert(const AnnotatedPosetObj& poset, InsertCounters& counters) {
+    counters.profile[poset.GetStatus()]++;
 
-    if (hashArray[index] == ((1u << 16) - 1) || poset.GetStatus() == SortableStatus::YES) {
-        if (hashArray[index] != ((1u << 16) - 1)) {
-            profileStorage[posetArray[index].GetStatus()]--;
+    uint8_t posetCode[PosetCode::maxSlotBytes];
+    bool encoded = code.encode(poset, posetCode);
+    assert(encoded);
+
+    insertCode(poset.GetHash(), createMeta(poset), posetCode, counters);
+}
+
+void OldGenMap::insertCode(uint64_t posetHash, uint8_t meta, const uint8_t *posetCode, InsertCounters &counters) {
+    size_t begin = setBegin(posetHash);
+    uint16_t hash = tag(posetHash);
+
+    // find slot: same tag, empty slot or entry with the lowest priority
+    size_t index = begin;
+    for (size_t i = begin; i < begin + ways; i++) {
+        if (hashArray[i] == hash || hashArray[i] == emptyTag) {
+            index = i;
+            break;
+        }
+        if (priority(metaArray[i]) < priority(metaArray[index])) {
+            index = i;
         }
-        hashArray[index] = hash;
-        posetArray[index] = poset;
-        profileStorage[poset.GetStatus()]++;
     }
-    empty = false;
+
+    if (hashArray[index] != emptyTag && hashArray[index] != hash) {
+        // set is full, age entries so that only recently used ones stay protected
+        bool replace = priority(meta) >= priority(metaArray[index]);
+        for (size_t i = begin; i < begin + ways; i++) {
+            metaArray[i] &= ~metaReferenced;
+        }
+        if (!replace) {
+            counters.rejections++;
+            return;
+        }
+        counters.evictions++;
+    }
+
+    if (hashArray[index] != emptyTag) {
+        counters.profileStorage[metaArray[index] & metaStatusMask]--;
+    }
+    hashArray[index] = hash;
+    metaArray[index] = meta;
+    memcpy(&codeArray[index * slotBytes], posetCode, slotBytes);
+    counters.profileStorage[meta & metaStatusMask]++;
 }
 
-PosetObj* OldGenMap::find(const AnnotatedPosetObj& poset) {
+SortableStatus OldGenMap::find(const AnnotatedPosetObj& poset) {
     if (empty) {
-        return nullptr;
+        return SortableStatus::UNFINISHED;
     }
 
-    uint64_t index = (poset.GetHash() * MULT1) % size;
-    uint16_t hash = (poset.GetHash() * MULT2) % ((1u << 16) - 1);
+    size_t begin = setBegin(poset.GetHash());
+    uint16_t hash = tag(poset.GetHash());
 
-    if (hashArray[index] != hash) {
-        return nullptr;
+    // the poset is only encoded if some tag matches
+    uint8_t posetCode[PosetCode::maxSlotBytes];
+    bool encoded = false;
+
+    for (size_t i = begin; i < begin + ways; i++) {
+        if (hashArray[i] != hash) {
+            continue;
+        }
+        if (!encoded) {
+            if (!code.encode(poset, posetCode)) {
+                // too many edges for this layer
+                return SortableStatus::UNFINISHED;
+            }
+            encoded = true;
+        }
+        const uint8_t *entryCode = &codeArray[i * slotBytes];
+        if (isEqual(poset, posetCode, entryCode)) {
+            // mark as recently used, find is called concurrently
+            if (!(__atomic_load_n(&metaArray[i], __ATOMIC_RELAXED) & metaReferenced)) {
+                __atomic_fetch_or(&metaArray[i], metaReferenced, __ATOMIC_RELAXED);
+            }
+            return PosetCode::getStatus(entryCode);
+        }
     }
+    return SortableStatus::UNFINISHED;
+}
 
-    auto &entry = posetArray[index];
+void OldGenMap::prefetch(const AnnotatedPosetObj &poset) const {
+    if (empty) {
+        return;
+    }
+    size_t begin = setBegin(poset.GetHash());
+    uint16_t hash = tag(poset.GetHash());
+    __builtin_prefetch(&metaArray[begin]);
+    for (size_t i = begin; i < begin + ways; i++) {
+        if (hashArray[i] == hash) {
+            __builtin_prefetch(&codeArray[i * slotBytes]);
+        }
+    }
+}
 
+bool OldGenMap::isEqual(const AnnotatedPosetObj &poset, const uint8_t *posetCode, const uint8_t *entryCode) const {
     // check equality
     Stats::inc(STAT::NEqualTest);
 
-    if (poset.isUniqueGraph() != entry.isUniqueGraph() || poset.GetSelfdualId() != entry.GetSelfdualId())
+    if (poset.isUniqueGraph() != PosetCode::isUniqueGraph(entryCode) ||
+        poset.GetSelfdualId() != PosetCode::getSelfdualId(entryCode))
     {
         Stats::inc(STAT::NInPosetHashDiff);
-        return nullptr;
+        return false;
     }
 
+    // the encoding is unique, so the graphs agree bit-wise iff the codes agree
     Stats::inc(STAT::NIsoTest);
-    if (poset.SameGraph(entry)){
-        Stats::inc(NIsoPositive);
-        assert(poset.isUniqueGraph() == entry.isUniqueGraph());
-        return &entry;
+    if (code.sameGraph(posetCode, entryCode)){
+        Stats::inc(STAT::NIsoPositive);
+        return true;
     }
 
-    //if the graph is unique and it does not agree bit-wise, we know that the graphs cannot be isomorphic
+    // isIsomorphicPoset rejects unique graphs that differ bit-wise, do it before decoding
     if (poset.isUniqueGraph() && !poset.GetSelfdualId())
-        return nullptr;
+        return false;
 
-    unsigned int reduced_n = poset.GetReducedN();
-    if(!entry.isSingletonsAbove(poset.GetFirstSingleton())){
-        Stats::inc(STAT::NSingletonsDiff);
-        return nullptr;
+    PosetObj entry;
+    code.decode(entryCode, entry);
+    return isIsomorphicPoset(poset, entry);
+}
+
+void OldGenMap::save(const std::filesystem::path &path) const {
+    SnapshotHeader header{snapshotMagic, NCT::N, NCT::C, layer, size, numSets, ways, slotBytes, MULT1, MULT2};
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(hashArray), static_cast<std::streamsize>(sizeof(uint16_t) * size));
+    file.write(reinterpret_cast<const char*>(metaArray), static_cast<std::streamsize>(sizeof(uint8_t) * size));
+    file.write(reinterpret_cast<const char*>(codeArray), static_cast<std::streamsize>(slotBytes * size));
+}
+
+bool OldGenMap::load(const std::filesystem::path &path) {
+    std::ifstream file{path, std::ios::binary};
+    SnapshotHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != snapshotMagic || header.n != NCT::N || header.c != NCT::C || header.layer != layer ||
+        header.slotBytes != slotBytes) {
+        return false;
     }
 
-    if(!entry.isPairs(reduced_n, poset.GetNumPairs())) {
-        Stats::inc(STAT::NPairsDiff);
-        return nullptr;
+    std::vector<uint16_t> hashes(header.size);
+    std::vector<uint8_t> metas(header.size);
+    std::vector<uint8_t> codes(header.size * header.slotBytes);
+    file.read(reinterpret_cast<char*>(hashes.data()), static_cast<std::streamsize>(sizeof(uint16_t) * header.size));
+    file.read(reinterpret_cast<char*>(metas.data()), static_cast<std::streamsize>(sizeof(uint8_t) * header.size));
+    file.read(reinterpret_cast<char*>(codes.data()), static_cast<std::streamsize>(header.slotBytes * header.size));
+    if (!file) {
+        return false;
     }
-    if (poset.GetSelfdualId()) {
-        if (boost_is_isomorphic(poset, entry, reduced_n))
-            return &entry;
-        if (boost_is_rev_isomorphic(poset, entry, reduced_n))
-            return &entry;
+
+    InsertCounters counters;
+    if (header.size == size && header.numSets == numSets && header.ways == ways && header.mult1 == MULT1 &&
+        header.mult2 == MULT2) {
+        // same layout, copy as is
+        memcpy(hashArray, hashes.data(), sizeof(uint16_t) * size);
+        memcpy(metaArray, metas.data(), sizeof(uint8_t) * size);
+        memcpy(codeArray, codes.data(), slotBytes * size);
+        for (size_t i = 0; i < size; i++) {
+            if (hashArray[i] != emptyTag) {
+                counters.profileStorage[metaArray[i] & metaStatusMask]++;
+            }
+        }
     } else {
-        if (boost_is_isomorphic(poset, entry, reduced_n))
-            return &entry;
+        // different layout, the hash has to be recomputed from the poset
+        for (size_t i = 0; i < header.size; i++) {
+            if (hashes[i] == emptyTag) {
+                continue;
+            }
+            PosetObj poset;
+            code.decode(&codes[i * slotBytes], poset);
+            auto handle = PosetHandleFull::fromPoset(poset);
+            insertCode(handle.GetHash(), metas[i] & ~metaReferenced, &codes[i * slotBytes], counters);
+        }
+    }
+    for (size_t i = 0; i < profileStorage.size(); i++) {
+        profileStorage[i] += counters.profileStorage[i];
+        if (counters.profileStorage[i] > 0) {
+            empty = false;
+        }
     }
-    return nullptr;
+    return true;
 }
@@ -26,29 +26,142 @@
 #define SORTINGLOWERBOUNDS_OLDGENMAP_H
 
 #include <cstdint>
+#include <filesystem>
 #include <boost/interprocess/managed_mapped_file.hpp>
 
 #include "posetObj.h"
+#include "posetCode.h"
 
+/**
+ * Fixed size cache for posets of one layer whose status is known. The cache is set associative, each set holds
+ * OldGenMap::ways posets. When a set is full, the entry with the lowest priority is replaced (see priority()).
+ * Posets are stored in the compact encoding of PosetCode, bounded by the number of edges a poset of the layer can have.
+ */
 class OldGenMap {
 
+public:
+    static constexpr unsigned int ways = 4;
+    // bytes of RAM required per entry
+    static constexpr size_t bytesPerEntry = sizeof(uint16_t) + sizeof(uint8_t);
+
+private:
+    static constexpr uint16_t emptyTag = (1u << 16) - 1;
+
+    // layout of metaArray entries
+    static constexpr uint8_t metaStatusMask = 0x03;
+    static constexpr uint8_t metaReferenced = 0x04;
+    static constexpr unsigned int metaCostShift = 3;
+
     boost::interprocess::managed_mapped_file::segment_manager *const segment_manager;
     uint16_t *hashArray;
-    PosetObj *posetArray;
+    uint8_t *metaArray;
+    uint8_t *codeArray;
+    unsigned int layer;
+    PosetCode code;
+    size_t slotBytes;
     bool empty;
+    size_t numSets;
 
 public:
     const size_t size;
     std::array<uint64_t, 8> profile;
     std::array<uint64_t, 8> profileStorage;
+    uint64_t evictions;
+    uint64_t rejections;
+    uint64_t lookups;
+    uint64_t hits;
+
+    /**
+     * Counters changed by insert, used to insert from several threads into disjoint sets.
+     */
+    struct InsertCounters {
+        std::array<uint64_t, 8> profile{};
+        // change of profileStorage, entries may wrap around
+        std::array<uint64_t, 8> profileStorage{};
+        uint64_t evictions = 0;
+        uint64_t rejections = 0;
+    };
 
 public:
-    OldGenMap(boost::interprocess::managed_mapped_file::segment_manager *segment_manager, size_t size);
+    OldGenMap(boost::interprocess::managed_mapped_file::segment_manager *segment_manager, size_t size, unsigned int layer);
     ~OldGenMap();
 
     void insert(const AnnotatedPosetObj& poset);
 
-    PosetObj* find(const AnnotatedPosetObj& poset);
+    /**
+     * Insert without touching shared state besides the set of the poset. Concurrent calls are allowed if they access
+     * different sets, the counters have to be merged afterwards.
+     */
+    void insert(const AnnotatedPosetObj& poset, InsertCounters& counters);
+
+    void mergeCounters(const InsertCounters& counters);
+
+    /**
+     * Stores all entries to a file, so that a later search with the same N and C can start with them.
+     */
+    void save(const std::filesystem::path& path) const;
+
+    /**
+     * Loads entries stored by save(). Snapshots with a different layout are re-inserted entry by entry. Returns false
+     * if the file is missing or belongs to a different N, C or layer.
+     */
+    bool load(const std::filesystem::path& path);
+
+    [[nodiscard]] inline size_t setIndex(uint64_t hash) const {
+        return (hash * MULT1) % numSets;
+    }
+
+    /**
+     * Returns the status of the poset or UNFINISHED if it is not contained.
+     */
+    SortableStatus find(const AnnotatedPosetObj& poset);
+
+    /**
+     * Prefetch the set of the poset and the entries with a matching tag. Used to overlap memory accesses of several
+     * lookups.
+     */
+    void prefetch(const AnnotatedPosetObj& poset) const;
+
+private:
+    [[nodiscard]] inline size_t setBegin(uint64_t hash) const {
+        return setIndex(hash) * ways;
+    }
+
+    [[nodiscard]] static inline uint16_t tag(uint64_t hash) {
+        return (hash * MULT2) % emptyTag;
+    }
+
+    /**
+     * Priority of an entry, the entry with the lowest priority in a set gets replaced. YES posets are preferred over NO
+     * posets, posets with more linear extensions (more expensive to resolve) over those with fewer and recently used
+     * posets over unused ones.
+     */
+    [[nodiscard]] static inline unsigned int priority(uint8_t meta) {
+        unsigned int statusWeight = (meta & metaStatusMask) == SortableStatus::YES ? 2 : 1;
+        unsigned int referenced = (meta & metaReferenced) ? 1 : 0;
+        return (statusWeight + referenced) * 32 + (meta >> metaCostShift);
+    }
+
+    static constexpr uint64_t snapshotMagic = 0x3130'4E45'4744'4C4FULL; // "OLDGEN01"
+
+    struct SnapshotHeader {
+        uint64_t magic;
+        unsigned int n;
+        unsigned int c;
+        unsigned int layer;
+        uint64_t size;
+        uint64_t numSets;
+        unsigned int ways;
+        uint64_t slotBytes;
+        uint64_t mult1;
+        uint64_t mult2;
+    };
+
+    void insertCode(uint64_t posetHash, uint8_t meta, const uint8_t *posetCode, InsertCounters& counters);
+
+    static uint8_t createMeta(const AnnotatedPosetObj& poset);
+
+    bool isEqual(const AnnotatedPosetObj& poset, const uint8_t *posetCode, const uint8_t *entryCode) const;
 };
 
 #endif //SORTINGLOWERBOUNDS_OLDGENMAP_H
@@ -0,0 +1,210 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "posetCode.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace {
+
+    constexpr unsigned int numBits = PosetObjCore::numGraphBits;
+    // one additional word, sum_{k <= numBits} binom(numBits, k) = 2^numBits
+    constexpr unsigned int numWords = numBits / 64 + 1;
+
+    struct WideInt {
+        std::array<uint64_t, numWords> words{};
+
+        void add(const WideInt &other) {
+            unsigned __int128 carry = 0;
+            for (unsigned int i = 0; i < numWords; i++) {
+                carry += static_cast<unsigned __int128>(words[i]) + other.words[i];
+                words[i] = static_cast<uint64_t>(carry);
+                carry >>= 64;
+            }
+        }
+
+        void sub(const WideInt &other) {
+            uint64_t borrow = 0;
+            for (unsigned int i = 0; i < numWords; i++) {
+                uint64_t val = words[i] - other.words[i] - borrow;
+                borrow = (words[i] < other.words[i] || (words[i] == other.words[i] && borrow)) ? 1 : 0;
+                words[i] = val;
+            }
+        }
+
+        [[nodiscard]] bool lessEqual(const WideInt &other) const {
+            for (unsigned int i = numWords; i-- > 0;) {
+                if (words[i] != other.words[i]) {
+                    return words[i] < other.words[i];
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] unsigned int bitLength() const {
+            for (unsigned int i = numWords; i-- > 0;) {
+                if (words[i] != 0) {
+                    return i * 64 + 64 - __builtin_clzll(words[i]);
+                }
+            }
+            return 0;
+        }
+
+        [[nodiscard]] uint8_t getByte(unsigned int i) const {
+            return static_cast<uint8_t>(words[i / 8] >> (8 * (i % 8)));
+        }
+
+        void setByte(unsigned int i, uint8_t val) {
+            words[i / 8] |= static_cast<uint64_t>(val) << (8 * (i % 8));
+        }
+    };
+
+    /**
+     * binom(n, k) for n <= numBits, k <= maxK and offsets[k] = sum_{j < k} binom(numBits, j).
+     */
+    struct BinomTable {
+        static constexpr unsigned int maxK = std::min(numBits, MAXENDC);
+
+        std::vector<WideInt> binom;
+        std::array<WideInt, maxK + 2> offsets;
+
+        BinomTable() : binom((numBits + 1) * (maxK + 1)) {
+            for (unsigned int n = 0; n <= numBits; n++) {
+                get(n, 0).words[0] = 1;
+                for (unsigned int k = 1; k <= std::min(n, maxK); k++) {
+                    get(n, k) = get(n - 1, k - 1);
+                    get(n, k).add(get(n - 1, k));
+                }
+            }
+            for (unsigned int k = 0; k <= maxK; k++) {
+                offsets[k + 1] = offsets[k];
+                offsets[k + 1].add(get(numBits, k));
+            }
+        }
+
+        [[nodiscard]] const WideInt &get(unsigned int n, unsigned int k) const {
+            return binom[n * (maxK + 1) + k];
+        }
+
+        WideInt &get(unsigned int n, unsigned int k) {
+            return binom[n * (maxK + 1) + k];
+        }
+    };
+
+    const BinomTable &binomTable() {
+        static const BinomTable table;
+        return table;
+    }
+}
+
+PosetCode::PosetCode(unsigned int maxEdges) :
+maxEdges(std::min(maxEdges, BinomTable::maxK)) {
+    WideInt maxRank = binomTable().offsets[this->maxEdges + 1];
+    WideInt one{};
+    one.words[0] = 1;
+    maxRank.sub(one);
+    rankBytes = std::max((maxRank.bitLength() + 7) / 8, 1u);
+    assert(slotBytes() <= maxSlotBytes);
+}
+
+uint8_t PosetCode::createFlags(const PosetObj &poset) {
+    uint8_t flags = poset.GetStatus() & flagStatusMask;
+    if (poset.GetSelfdualId())
+        flags |= flagSelfdual;
+    if (poset.isUniqueGraph())
+        flags |= flagUnique;
+    if (poset.isMarked())
+        flags |= flagMark;
+    return flags;
+}
+
+unsigned int PosetCode::edgeCount(const PosetObj &poset) {
+    const PosetObjCore &core = poset.posetCore;
+    unsigned int k = 0;
+    for (unsigned int byte = 0; byte <= PosetObjCore::numMainGraphChars; byte++) {
+        unsigned int bits = byte < PosetObjCore::numMainGraphChars ? core.graphMain[byte] : core.graphLastBits;
+        k += __builtin_popcount(bits);
+    }
+    return k;
+}
+
+bool PosetCode::encode(const PosetObj &poset, uint8_t *slot) const {
+    const auto &table = binomTable();
+    const PosetObjCore &core = poset.posetCore;
+
+    WideInt rank{};
+    unsigned int k = 0;
+    for (unsigned int byte = 0; byte <= PosetObjCore::numMainGraphChars; byte++) {
+        unsigned int bits = byte < PosetObjCore::numMainGraphChars ? core.graphMain[byte] : core.graphLastBits;
+        while (bits != 0) {
+            unsigned int pos = byte * PosetObjCore::wordLength + __builtin_ctz(bits);
+            bits &= bits - 1;
+            k++;
+            if (k > maxEdges) {
+                return false;
+            }
+            rank.add(table.get(pos, k));
+        }
+    }
+    rank.add(table.offsets[k]);
+
+    slot[0] = createFlags(poset);
+    for (unsigned int i = 0; i < rankBytes; i++) {
+        slot[i + 1] = rank.getByte(i);
+    }
+    return true;
+}
+
+void PosetCode::decode(const uint8_t *slot, PosetObj &poset) const {
+    const auto &table = binomTable();
+
+    WideInt rank{};
+    for (unsigned int i = 0; i < rankBytes; i++) {
+        rank.setByte(i, slot[i + 1]);
+    }
+
+    unsigned int k = 0;
+    while (k < maxEdges && table.offsets[k + 1].lessEqual(rank)) {
+        k++;
+    }
+    rank.sub(table.offsets[k]);
+
+    PosetObjCore &core = poset.posetCore;
+    core.graphReset();
+    unsigned int pos = numBits;
+    for (unsigned int i = k; i >= 1; i--) {
+        // largest pos with binom(pos, i) <= rank
+        do {
+            pos--;
+        } while (!table.get(pos, i).lessEqual(rank));
+        core.graphSet(pos);
+        rank.sub(table.get(pos, i));
+    }
+
+    core.SetStatus(getStatus(slot));
+    core.SetSelfdualId(getSelfdualId(slot));
+    core.setUniqueGraph(isUniqueGraph(slot));
+    core.setMark(isMarked(slot));
+}
@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_POSETCODE_H
+#define SORTINGLOWERBOUNDS_POSETCODE_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "posetObj.h"
+
+/**
+ * Fixed size encoding of posets with at most maxEdges edges. Posets are stored as transitive reductions and every
+ * comparison adds at most one edge to the reduction, hence all posets on layer c have at most c edges.
+ *
+ * A slot consists of one flag byte followed by the rank of the set of edge positions in the combinatorial number
+ * system (little endian). The rank needs log2(sum_{k <= maxEdges} binom(numGraphBits, k)) bits, which is considerably
+ * less than numGraphBits for the lower layers.
+ */
+class PosetCode {
+
+public:
+    static constexpr uint8_t flagStatusMask = 0x03;
+    static constexpr uint8_t flagSelfdual = 0x04;
+    static constexpr uint8_t flagUnique = 0x08;
+    static constexpr uint8_t flagMark = 0x10;
+    // not used by PosetCode itself, containers may use it to mark slots that refer to an uncompressed poset
+    static constexpr uint8_t flagOverflow = 0x20;
+
+    static constexpr size_t maxSlotBytes = 1 + (PosetObjCore::numGraphBits + 7) / 8;
+
+private:
+    unsigned int maxEdges;
+    size_t rankBytes;
+
+public:
+    explicit PosetCode(unsigned int maxEdges);
+
+    [[nodiscard]] inline size_t slotBytes() const {
+        return 1 + rankBytes;
+    }
+
+    [[nodiscard]] inline unsigned int getMaxEdges() const {
+        return maxEdges;
+    }
+
+    /**
+     * Writes slotBytes() bytes to slot. Returns false (and leaves slot undefined) if the poset has more than maxEdges
+     * edges.
+     */
+    bool encode(const PosetObj &poset, uint8_t *slot) const;
+
+    void decode(const uint8_t *slot, PosetObj &poset) const;
+
+    /**
+     * Number of edges of the transitive reduction stored in the poset.
+     */
+    [[nodiscard]] static unsigned int edgeCount(const PosetObj &poset);
+
+    /**
+     * Compares the graphs of two slots created by this code, flags are ignored.
+     */
+    [[nodiscard]] inline bool sameGraph(const uint8_t *first, const uint8_t *second) const {
+        return memcmp(first + 1, second + 1, rankBytes) == 0;
+    }
+
+    [[nodiscard]] static inline SortableStatus getStatus(const uint8_t *slot) {
+        return static_cast<SortableStatus>(slot[0] & flagStatusMask);
+    }
+
+    [[nodiscard]] static inline bool isMarked(const uint8_t *slot) {
+        return (slot[0] & flagMark) != 0;
+    }
+
+    [[nodiscard]] static inline bool getSelfdualId(const uint8_t *slot) {
+        return (slot[0] & flagSelfdual) != 0;
+    }
+
+    [[nodiscard]] static inline bool isUniqueGraph(const uint8_t *slot) {
+        return (slot[0] & flagUnique) != 0;
+    }
+
+    [[nodiscard]] static uint8_t createFlags(const PosetObj &poset);
+};
+
+#endif //SORTINGLOWERBOUNDS_POSETCODE_H
@@ -25,41 +25,68 @@
 #include "posetContainer.h"
 #include "semiOfflineVector.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <mutex>
 
 #include "posetObj.h"
 #include "mmapAllocator.h"
+#include "slabAllocator.h"
 
 
 static MmapAllocator alloc;
 
 bool PosetContainerTemplate::useMmap = false;
 
-PosetObj &PosetContainerTemplate::get(uint64_t index) const {
+PosetContainerTemplate::PosetContainerTemplate(unsigned int maxEdges) :
+num_elements(0),
+code(maxEdges),
+slotBytes(std::max(code.slotBytes(), 1 + sizeof(uint32_t))) {
+}
+
+size_t PosetContainerTemplate::blockPosets() const {
+    // the allocator hands out memory in units of PosetObj
+    return (blockSize * slotBytes + sizeof(PosetObj) - 1) / sizeof(PosetObj);
+}
+
+PosetObj PosetContainerTemplate::get(uint64_t index) const {
 
     assert(index <= this->num_elements);
 
-    return listHeads[index / blockSize][index % blockSize];
+    const uint8_t *entry = slot(index);
+    if (entry[0] & PosetCode::flagOverflow) {
+        uint32_t overflowIndex;
+        memcpy(&overflowIndex, entry + 1, sizeof(overflowIndex));
+        return overflow[overflowIndex];
+    }
+    PosetObj poset;
+    code.decode(entry, poset);
+    return poset;
 }
 
 uint64_t PosetContainerTemplate::insert(const PosetObj &poset) {
 
     if (listHeads.size() * blockSize == this->num_elements) {
         if (useMmap) {
-            this->listHeads.push_back(alloc.requestMemory(blockSize));
+            this->listHeads.push_back(reinterpret_cast<uint8_t*>(alloc.requestMemory(blockPosets())));
         } else {
-            this->listHeads.push_back(static_cast<PosetObj*>(malloc(sizeof(PosetObj) * blockSize)));
+            this->listHeads.push_back(static_cast<uint8_t*>(SlabAllocator::allocate(slotBytes * blockSize)));
         }
     }
 
     size_t index = num_elements++;
 
-    PosetObj* pointer = &listHeads[index / blockSize][index % blockSize];
+    uint8_t *entry = slot(index);
 
-    assert(pointer != nullptr);
+    assert(entry != nullptr);
 
-    new(pointer) PosetObj(poset);
+    if (!code.encode(poset, entry)) {
+        auto overflowIndex = static_cast<uint32_t>(overflow.size());
+        overflow.push_back(poset);
+        entry[0] = PosetCode::createFlags(poset) | PosetCode::flagOverflow;
+        memcpy(entry + 1, &overflowIndex, sizeof(overflowIndex));
+    }
 
     return index;
 }
@@ -68,9 +95,9 @@ std::array<uint64_t, 8> PosetContainerTemplate::countPosetsDetailed(bool unmarke
 
     std::array<uint64_t, 8> result = { 0, 0, 0, 0, 0, 0, 0 ,0};
     for (int index = 0; index < this->num_elements; index++) {
-        PosetObj &poset = get(index);
-        if (unmarked || poset.isMarked()) {
-            result[poset.GetStatus()]++;
+        const uint8_t *entry = slot(index);
+        if (unmarked || PosetCode::isMarked(entry)) {
+            result[PosetCode::getStatus(entry)]++;
         }
     }
     return result;
@@ -79,11 +106,12 @@ std::array<uint64_t, 8> PosetContainerTemplate::countPosetsDetailed(bool unmarke
 PosetContainerTemplate::~PosetContainerTemplate() {
     for (auto ptr: listHeads) {
         if (useMmap) {
-            alloc.returnMemory(ptr, blockSize);
+            alloc.returnMemory(reinterpret_cast<PosetObj*>(ptr), blockPosets());
         } else {
-            free(ptr);
+            SlabAllocator::deallocate(ptr, slotBytes * blockSize);
         }
     }
     listHeads.clear();
+    overflow.clear();
     num_elements = 0;
 }
@@ -29,22 +29,29 @@
 #include "posetPointer.h"
 #include "posetHandle.h"
 #include "posetObj.h"
+#include "posetCode.h"
 
+/**
+ * Stores posets in blocks of fixed size slots using the encoding of PosetCode. Posets with more than maxEdges edges
+ * are kept uncompressed in an overflow list, their slot holds the index into that list.
+ */
 class PosetContainerTemplate {
 
     static constexpr size_t blockSize = 1 << 17;
 
 	unsigned int num_elements;
 
-    std::vector<PosetObj*> listHeads;
+    PosetCode code;
+    size_t slotBytes;
+
+    std::vector<uint8_t*> listHeads;
+    std::vector<PosetObj> overflow;
 
 public:
 
     static bool useMmap;
 
-    PosetContainerTemplate() {
-        this->num_elements = 0;
-    }
+    explicit PosetContainerTemplate(unsigned int maxEdges = MAXENDC);
 
     PosetContainerTemplate(const PosetContainerTemplate&) = delete;
     PosetContainerTemplate(PosetContainerTemplate && other ) noexcept = default;
@@ -54,7 +61,7 @@ public:
 
     ~PosetContainerTemplate();
 
-    [[nodiscard]] PosetObj& get(uint64_t index) const;
+    [[nodiscard]] PosetObj get(uint64_t index) const;
 
     uint64_t insert( const PosetObj & poset);
 
@@ -63,6 +70,20 @@ public:
     [[nodiscard]] uint64_t size() const {
         return num_elements;
     }
+
+    /**
+     * Bytes allocated for the slots and the overflow list.
+     */
+    [[nodiscard]] uint64_t memoryBytes() const {
+        return listHeads.size() * blockSize * slotBytes + overflow.capacity() * sizeof(PosetObj);
+    }
+
+private:
+    [[nodiscard]] inline uint8_t* slot(uint64_t index) const {
+        return &listHeads[index / blockSize][(index % blockSize) * slotBytes];
+    }
+
+    [[nodiscard]] size_t blockPosets() const;
 };
 
 class PosetContainer {
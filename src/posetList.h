@@ -0,0 +1,185 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_POSETLIST_H
+#define SORTINGLOWERBOUNDS_POSETLIST_H
+
+#include <cstdint>
+#include <memory>
+
+#include "posetObj.h"
+#include "sortableStatus.h"
+#include "semiOfflineVector.h"
+#include "offlineStorage.h"
+
+/**
+ * Search state of a poset in the forward search: status, mark and the index of its edge list entry.
+ */
+class PosetState {
+    static constexpr uint64_t elIndexMask = (uint64_t(1) << 61) - 1;
+    static constexpr unsigned int statusShift = 61;
+    static constexpr uint64_t statusMask = uint64_t(3) << statusShift;
+    static constexpr uint64_t markBit = uint64_t(1) << 63;
+
+    // elIndex in the lower 61 bits, then status and mark, in one word so the mark can be set atomically
+    uint64_t word;
+
+    void setStatus(SortableStatus status) {
+        word = (word & ~statusMask) | (uint64_t(status) << statusShift);
+    }
+
+public:
+    PosetState() : word(uint64_t(SortableStatus::UNFINISHED) << statusShift) {}
+
+    explicit PosetState(const PosetObj &poset) :
+            word((uint64_t(poset.GetStatus()) << statusShift) | (poset.isMarked() ? markBit : 0)) {}
+
+    [[nodiscard]] inline SortableStatus GetStatus() const {
+        return static_cast<SortableStatus>((word & statusMask) >> statusShift);
+    }
+
+    inline void SetUnsortable() {
+        assert(GetStatus() == SortableStatus::UNFINISHED);
+        setStatus(SortableStatus::NO);
+    }
+
+    inline void SetSortable() {
+        assert(GetStatus() == SortableStatus::UNFINISHED);
+        setStatus(SortableStatus::YES);
+    }
+
+    [[nodiscard]] inline bool isMarked() const {
+        return word & markBit;
+    }
+
+    inline void setMark(bool pMark) {
+        word = pMark ? word | markBit : word & ~markBit;
+    }
+
+    /**
+     * Mark, safe to read while other threads call markConcurrent.
+     */
+    [[nodiscard]] inline bool isMarkedConcurrent() const {
+        return __atomic_load_n(&word, __ATOMIC_RELAXED) & markBit;
+    }
+
+    /**
+     * Sets the mark, safe to call concurrently for the same state if no other thread changes it otherwise.
+     */
+    inline void markConcurrent() {
+        __atomic_fetch_or(&word, markBit, __ATOMIC_RELAXED);
+    }
+
+    [[nodiscard]] inline uint64_t getElIndex() const {
+        return word & elIndexMask;
+    }
+
+    inline void setElIndex(uint64_t index) {
+        // truncated to 61 bits, -1 is stored as all ones
+        word = (word & ~elIndexMask) | (index & elIndexMask);
+    }
+};
+
+static_assert(sizeof(PosetState) == sizeof(uint64_t));
+
+/**
+ * The posets of the forward search stored as two columns of equal length: the states, which are all that phase 2 and
+ * the marking passes touch, and the posets with their info and number of linear extensions. The columns spill to
+ * separate storages and are brought online independently. The status and mark stored in the posets are not updated.
+ */
+class PosetList {
+    SemiOfflineVector<PosetState> states;
+    SemiOfflineVector<AnnotatedPosetObj> posets;
+
+public:
+    PosetList(size_t onlineCapacity, size_t offlineCapacity, std::unique_ptr<OfflineStorage> stateStorage,
+              std::unique_ptr<OfflineStorage> posetStorage) :
+            states(onlineCapacity, offlineCapacity, std::move(stateStorage)),
+            posets(onlineCapacity, offlineCapacity, std::move(posetStorage)) {}
+
+    [[nodiscard]] size_t size() const {
+        return states.size();
+    }
+
+    /**
+     * Appends a poset, safe to call concurrently. Its state is taken from the status and mark of the poset.
+     */
+    size_t insert(const AnnotatedPosetObj &poset) {
+        size_t pos = states.insert(PosetState(poset));
+        posets.insertAt(pos, poset);
+        return pos;
+    }
+
+    PosetState &state(size_t pos) {
+        return states[pos];
+    }
+
+    AnnotatedPosetObj &poset(size_t pos) {
+        return posets[pos];
+    }
+
+    const AnnotatedPosetObj &get(size_t pos) {
+        return posets[pos];
+    }
+
+    /**
+     * The poset with the status of its state, as stored in the old gen maps.
+     */
+    [[nodiscard]] AnnotatedPosetObj withStatus(size_t pos) {
+        AnnotatedPosetObj result = posets[pos];
+        if (states[pos].GetStatus() == SortableStatus::YES) {
+            result.SetSortable();
+        } else if (states[pos].GetStatus() == SortableStatus::NO) {
+            result.SetUnsortable();
+        }
+        return result;
+    }
+
+    void resize(size_t newSize) {
+        states.resize(newSize);
+        posets.resize(newSize);
+    }
+
+    void ensureOnlineAvailable(size_t requiredAvailable) {
+        states.ensureOnlineAvailable(requiredAvailable);
+        posets.ensureOnlineAvailable(requiredAvailable);
+    }
+
+    void ensureOnlineFrom(size_t begin) {
+        states.ensureOnlineFrom(begin);
+        posets.ensureOnlineFrom(begin);
+    }
+
+    /**
+     * Brings only the states online, the posets stay where they are.
+     */
+    void ensureStatesOnlineFrom(size_t begin) {
+        states.ensureOnlineFrom(begin);
+    }
+
+    void ensurePosetsOnlineFrom(size_t begin) {
+        posets.ensureOnlineFrom(begin);
+    }
+};
+
+#endif //SORTINGLOWERBOUNDS_POSETLIST_H
@@ -24,10 +24,14 @@
 
 #include "posetMap.h"
 
+#include <numeric>
+
 #include "config.h"
 #include "myHashmap.h"
+#include "searchParams.h"
+#include "threadPool.h"
 
-PosetMap::PosetMap(size_t initialCapacity) : SposetMap() {
+PosetMap::PosetMap(size_t initialCapacity, unsigned int maxEdges) : SposetMap() {
 
     numLocks = initialCapacity / 4096;
     numLocks = std::max(NCT::num_threads_glob, numLocks);
@@ -43,7 +47,7 @@ PosetMap::PosetMap(size_t initialCapacity) : SposetMap() {
     SposetMap.reserve(numLocks);
 
     for (int lock = 0; lock < numLocks; lock++) {
-        auto &container = Scontainers.emplace_back();
+        auto &container = Scontainers.emplace_back(maxEdges);
         SposetMap.emplace_back(std::ref(container), hmap_initial_capacity);
     }
 }
@@ -56,6 +60,14 @@ uint64_t PosetMap::countPosets() {
     return result;
 }
 
+uint64_t PosetMap::memoryBytes() const {
+    uint64_t result = 0;
+    for (int lockId = 0; lockId < numLocks; lockId++) {
+        result += SposetMap[lockId].memoryBytes() + Scontainers[lockId].memoryBytes();
+    }
+    return result;
+}
+
 std::array<uint64_t, 8> PosetMap::countPosetsDetailed(bool unmarked) {
     std::array<uint64_t, 8> result = { 0, 0, 0, 0, 0, 0, 0,0 };
     for (int lockId = 0; lockId <  numLocks; lockId++) {
@@ -66,15 +78,64 @@ std::array<uint64_t, 8> PosetMap::countPosetsDetailed(bool unmarked) {
     return result;
 }
 
-PosetObj *PosetMap::find(AnnotatedPosetObj &candidate) {
-    return SposetMap[candidate.GetLockHash() % numLocks].find(candidate);
+std::optional<PosetObj> PosetMap::find(AnnotatedPosetObj &candidate) {
+    auto result = SposetMap[candidate.GetLockHash() % numLocks].find(candidate);
+    if (!result && diskLayers) {
+        return diskLayers->find(candidate);
+    }
+    return result;
 }
 
-PosetObj &PosetMap::findAndInsert(AnnotatedPosetObj &candidate) {
+PosetObj PosetMap::findAndInsert(AnnotatedPosetObj &candidate) {
     uint64_t index = SposetMap[candidate.GetLockHash() % numLocks].findAndInsert(candidate);
     return Scontainers[candidate.GetLockHash() % numLocks].get(index);
 }
 
+void PosetMap::insertBulk(const std::vector<AnnotatedPosetObj> &posets) {
+    unsigned int numWorkers = posets.size() > SearchParams::batchSize * 4 && NCT::num_threads > 1 ? NCT::num_threads : 1;
+    if (numWorkers == 1) {
+        for (const auto &poset: posets) {
+            SposetMap[poset.GetLockHash() % numLocks].findAndInsertExclusive(poset);
+        }
+        return;
+    }
+    assert(posets.size() <= UINT32_MAX);
+
+    // bucket the posets by the worker owning their hash map: count per owner in every part of the posets (split like
+    // runRange splits them), then scatter the indices to the prefix sums, ordered by owner and part
+    std::vector<uint32_t> owners(posets.size());
+    std::vector<size_t> offsets(numWorkers * numWorkers + 1, 0);
+    ThreadPool::runRange(posets.size(), [&](ThreadPool::Worker &worker, size_t begin, size_t end) {
+        std::vector<size_t> counts(numWorkers, 0);
+        for (auto i = begin; i < end; i++) {
+            owners[i] = posets[i].GetLockHash() % numLocks % numWorkers;
+            counts[owners[i]]++;
+        }
+        for (unsigned int owner = 0; owner < numWorkers; owner++) {
+            offsets[owner * numWorkers + worker.id + 1] = counts[owner];
+        }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> indices(posets.size());
+    ThreadPool::runRange(posets.size(), [&](ThreadPool::Worker &worker, size_t begin, size_t end) {
+        std::vector<size_t> positions(numWorkers);
+        for (unsigned int owner = 0; owner < numWorkers; owner++) {
+            positions[owner] = offsets[owner * numWorkers + worker.id];
+        }
+        for (auto i = begin; i < end; i++) {
+            indices[positions[owners[i]]++] = i;
+        }
+    });
+
+    // each worker inserts its bucket
+    ThreadPool::run(numWorkers, [&](ThreadPool::Worker &worker) {
+        for (auto k = offsets[worker.id * numWorkers]; k < offsets[(worker.id + 1) * numWorkers]; k++) {
+            const auto &poset = posets[indices[k]];
+            SposetMap[poset.GetLockHash() % numLocks].findAndInsertExclusive(poset);
+        }
+    });
+}
+
 void PosetMap::fill(std::vector<PosetObj>& vec) {
     vec.reserve(countPosets());
     for (int lockId = 0; lockId <  numLocks; lockId++) {
@@ -85,7 +146,7 @@ void PosetMap::fill(std::vector<PosetObj>& vec) {
     }
 }
 
-PosetMapExt::PosetMapExt(SemiOfflineVector<AnnotatedPosetObj> &container, size_t initialCapacity) : SposetMap() {
+PosetMapExt::PosetMapExt(PosetList &container, size_t initialCapacity) : SposetMap() {
 
     numLocks = initialCapacity / 4096;
     numLocks = std::max(NCT::num_threads_glob, numLocks);
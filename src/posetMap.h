@@ -28,11 +28,13 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <optional>
 
 #include "myHashmap.h"
 #include "posetPointer.h"
 #include "posetContainer.h"
-#include "semiOfflineVector.h"
+#include "diskLayerMap.h"
+#include "posetList.h"
 
 class PosetObj;
 class PosetHandleFull;
@@ -46,25 +48,55 @@ public:
     alignas(64) std::vector<MyHashmap<PosetPointer<24, 7, 1>, PosetContainerTemplate>>  SposetMap;
     alignas(64) std::vector<PosetContainerTemplate>  Scontainers;
 
+    /**
+     * Stored layers that are searched if a poset is not in the hash maps, can be empty.
+     */
+    std::unique_ptr<DiskLayerMap> diskLayers;
+
     PosetMap(const PosetMap&) = delete;
     PosetMap(PosetMap&&) noexcept = default;
     PosetMap& operator= (PosetMap&) = delete;
     PosetMap& operator= (PosetMap&&) noexcept = default;
 
-    explicit PosetMap(size_t initialCapacity);
+    /**
+     * Posets with more than maxEdges edges are stored uncompressed (see PosetContainerTemplate).
+     */
+    explicit PosetMap(size_t initialCapacity, unsigned int maxEdges = MAXENDC);
 
     /**
-     * Find a poset in the hash map. Returns nullptr if not found.
+     * Find a poset in the hash map or the disk layers. Returns an empty optional if not found.
      */
-    PosetObj* find(AnnotatedPosetObj& candidate);
+    std::optional<PosetObj> find(AnnotatedPosetObj& candidate);
 
     /**
-     * Find a poset in the hash map. Insert if not found. Returns a reference to the existing or inserted poset.
+     * Prefetch the hash map entry of the candidate. The map must not be modified concurrently.
      */
-    PosetObj& findAndInsert(AnnotatedPosetObj& candidate);
+    void prefetch(const AnnotatedPosetObj& candidate) const {
+        SposetMap[candidate.GetLockHash() % numLocks].prefetch(candidate);
+        if (diskLayers) {
+            diskLayers->prefetch(candidate);
+        }
+    }
+
+    /**
+     * Find a poset in the hash map. Insert if not found. Returns a copy of the existing or inserted poset.
+     */
+    PosetObj findAndInsert(AnnotatedPosetObj& candidate);
+
+    /**
+     * Insert many posets using all workers of the pool. Each worker owns a disjoint set of hash maps, so no locking is required.
+     * The posets are bucketed by their owner first, so every worker only reads its own posets.
+     * Posets that are already contained in the map are skipped.
+     */
+    void insertBulk(const std::vector<AnnotatedPosetObj>& posets);
 
     uint64_t countPosets();
 
+    /**
+     * Bytes allocated by the hash maps and their containers.
+     */
+    [[nodiscard]] uint64_t memoryBytes() const;
+
     std::array<uint64_t, 8> countPosetsDetailed(bool unmarked = true);
 
     void fill(std::vector<PosetObj>& vec);
@@ -79,9 +111,9 @@ class PosetMapExt {
 
 public:
 
-    alignas(64) std::vector<MyHashmap<PosetPointer<64, 32, 32>, SemiOfflineVector<AnnotatedPosetObj>>> SposetMap;
+    alignas(64) std::vector<MyHashmap<PosetPointer<64, 32, 32>, PosetList>> SposetMap;
 
-    explicit PosetMapExt(SemiOfflineVector<AnnotatedPosetObj> &container, size_t initialCapacity);
+    explicit PosetMapExt(PosetList &container, size_t initialCapacity);
 
     /**
      * Find a poset in the hash map. Insert if not found. Returns a reference to the existing or inserted poset.
@@ -47,6 +47,8 @@ constexpr std::array<unsigned int, MAXN> fill_array() {
 
 
 class PosetObj {
+
+    friend class PosetCode;
     typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS> Boostgraph;
 
 	static constexpr std::array<unsigned int, MAXN> jOffset = fill_array();
@@ -168,10 +170,9 @@ class AnnotatedPosetObj : public PosetObj, public PosetInfoFull {
 
 public:
 
-    uint64_t elIndex;
     LinExtT linExt;
 
-    AnnotatedPosetObj(const PosetObj &poset, PosetInfoFull info, LinExtT linExt) : PosetObj(poset), PosetInfoFull(info), linExt(linExt), elIndex(0) {}
+    AnnotatedPosetObj(const PosetObj &poset, PosetInfoFull info, LinExtT linExt) : PosetObj(poset), PosetInfoFull(info), linExt(linExt) {}
 
     AnnotatedPosetObj() : PosetObj(), PosetInfoFull(PosetInfo(0, 0), 0) {}
 
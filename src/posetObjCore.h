@@ -35,6 +35,8 @@
 
 class PosetObjCore {
 
+    friend class PosetCode;
+
 public:
 
     static constexpr unsigned int numGraphBits = (MAXN* (MAXN - 1)) / 2;
@@ -25,6 +25,7 @@
 #include "searchParams.h"
 
 uint32_t SearchParams::batchSize = 8;
+uint32_t SearchParams::lookupBatchSize = 8;
 uint64_t SearchParams::fwSearchChildrenLimit = 50'000;
 uint64_t SearchParams::fwSearchParentsInRam = 5'000;
 uint64_t SearchParams::bwSearchPosetLimit = 10'000'000'000;
@@ -30,6 +30,8 @@
 class SearchParams {
 public:
     static uint32_t batchSize;
+    // comparisons of one parent whose children are prefetched together
+    static uint32_t lookupBatchSize;
     static uint64_t fwSearchChildrenLimit;
     static uint64_t fwSearchParentsInRam;
     static uint64_t bwSearchPosetLimit;
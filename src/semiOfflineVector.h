@@ -30,8 +30,12 @@
 #include <cassert>
 #include <mutex>
 #include <cstdlib>
-#include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/managed_mapped_file.hpp>
+#include <algorithm>
+#include <memory>
+
+#include "offlineCodec.h"
+#include "offlineStorage.h"
+#include "slabAllocator.h"
 
 
 template<class T>
@@ -40,30 +44,151 @@ class SemiOfflineVector {
 private:
     const size_t onlineCapacity;
     const size_t offlineCapacity;
-    boost::interprocess::managed_mapped_file::segment_manager *const segment_manager;
+    const std::unique_ptr<OfflineStorage> storage;
+    const size_t alignment;
 
     T* onlineVec;
-    T* offlineVec;
+    // offline elements are stored as encoded blocks (see OfflineCodec), the offline part only grows and shrinks at its end
+
+    struct OfflineBlock {
+        size_t begin;
+        size_t count;
+        size_t byteOffset;
+        size_t byteSize;
+        bool raw;
+    };
+
+    static constexpr size_t blockElements = 1 << 12;
+    std::vector<OfflineBlock> blocks;
+    std::vector<T> blockBuffer;
+    // staging area for storage io, aligned and padded as required by the storage backend
+    uint8_t* encodeBuffer;
 
     size_t required_online = 0;
     std::atomic<size_t> sizeTotal{};
     std::atomic<size_t> sizeOffline{};
 
     std::mutex lock;
+
+    [[nodiscard]] size_t alignUp(size_t bytes) const {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    [[nodiscard]] size_t offlineBytesUsed() const {
+        return blocks.empty() ? 0 : alignUp(blocks.back().byteOffset + blocks.back().byteSize);
+    }
+
+    /**
+     * Decodes the elements of block to blockBuffer.
+     */
+    void loadBlock(const OfflineBlock &block) {
+        storage->read(block.byteOffset, encodeBuffer, alignUp(block.byteSize));
+        if (block.raw) {
+            memcpy(blockBuffer.data(), encodeBuffer, block.count * sizeof(T));
+        } else {
+            OfflineCodec<T>::decode(encodeBuffer, block.count, blockBuffer.data());
+        }
+    }
+
+    /**
+     * Encodes the first block.count elements of blockBuffer and writes them at block.byteOffset, blocks that do not
+     * shrink are stored raw.
+     */
+    void storeBlock(OfflineBlock &block) {
+        block.byteSize = OfflineCodec<T>::encode(blockBuffer.data(), block.count, encodeBuffer);
+        block.raw = false;
+        if (block.byteSize >= block.count * sizeof(T)) {
+            block.byteSize = block.count * sizeof(T);
+            block.raw = true;
+            memcpy(encodeBuffer, blockBuffer.data(), block.byteSize);
+        }
+        assert(alignUp(block.byteOffset + block.byteSize) <= storageCapacity());
+        storage->write(block.byteOffset, encodeBuffer, alignUp(block.byteSize));
+    }
+
+    /**
+     * Appends the online elements [sizeOffline, end) to the offline part. A partial last block is filled up first, so
+     * all blocks but the last hold blockElements elements.
+     */
+    void writeOffline(size_t end) {
+        for (size_t begin = sizeOffline; begin < end;) {
+            OfflineBlock block{begin, 0, offlineBytesUsed(), 0, false};
+            if (!blocks.empty() && blocks.back().count < blockElements) {
+                assert(blocks.back().begin + blocks.back().count == begin);
+                block = blocks.back();
+                blocks.pop_back();
+                loadBlock(block);
+            }
+            size_t count = std::min(end - begin, blockElements - block.count);
+            for (size_t i = 0; i < count; i++) {
+                blockBuffer[block.count + i] = onlineVec[(begin + i) % onlineCapacity];
+            }
+            block.count += count;
+            storeBlock(block);
+            blocks.push_back(block);
+            begin += count;
+        }
+    }
+
+    /**
+     * Copies the offline elements [begin, sizeOffline) back to the online ring.
+     */
+    void readOffline(size_t begin) {
+        auto block = std::upper_bound(blocks.begin(), blocks.end(), begin, [](size_t pos, const OfflineBlock &b) {
+            return pos < b.begin;
+        }) - 1;
+        for (; block != blocks.end(); ++block) {
+            loadBlock(*block);
+            for (size_t i = std::max(begin, block->begin) - block->begin; i < block->count; i++) {
+                onlineVec[(block->begin + i) % onlineCapacity] = blockBuffer[i];
+            }
+        }
+    }
+
+    /**
+     * Drops the offline elements at and after newEnd. A cut block is stored again, so its dropped tail does not keep
+     * using storage.
+     */
+    void truncateOffline(size_t newEnd) {
+        while (!blocks.empty() && blocks.back().begin >= newEnd) {
+            blocks.pop_back();
+        }
+        if (!blocks.empty() && blocks.back().begin + blocks.back().count > newEnd) {
+            auto &block = blocks.back();
+            loadBlock(block);
+            block.count = newEnd - block.begin;
+            storeBlock(block);
+        }
+    }
+
+    /**
+     * Bytes of the storage used in the worst case: every element stored raw plus the padding of every block. All
+     * blocks but the last are full.
+     */
+    [[nodiscard]] size_t storageCapacity() const {
+        return offlineCapacity * sizeof(T) + (offlineCapacity / blockElements + 2) * alignment;
+    }
+
 public:
-    SemiOfflineVector(size_t onlineCapacity, size_t offlineCapacity, boost::interprocess::managed_mapped_file::segment_manager *segment_manager) : onlineCapacity(onlineCapacity),
+    SemiOfflineVector(size_t onlineCapacity, size_t offlineCapacity, std::unique_ptr<OfflineStorage> storage) : onlineCapacity(onlineCapacity),
                                                                                                           offlineCapacity(offlineCapacity),
-                                                                                                          segment_manager(segment_manager),
+                                                                                                          storage(std::move(storage)),
+                                                                                                          alignment(this->storage->alignment()),
                                                                                                           lock(),
                                                                                                           sizeOffline(0),
                                                                                                           sizeTotal(0) {
-        onlineVec = static_cast<T*>(malloc(onlineCapacity * sizeof(T)));
-        offlineVec = static_cast<T*>(segment_manager->allocate(offlineCapacity * sizeof(T)));
+        onlineVec = static_cast<T*>(SlabAllocator::allocate(onlineCapacity * sizeof(T)));
+        this->storage->reserve(storageCapacity());
+        blockBuffer.resize(blockElements);
+        size_t bufferAlignment = std::max(alignment, alignof(std::max_align_t));
+        size_t encodeBufferSize = alignUp(std::max(OfflineCodec<T>::maxEncodedBytes(blockElements), blockElements * sizeof(T)));
+        encodeBufferSize = (encodeBufferSize + bufferAlignment - 1) / bufferAlignment * bufferAlignment;
+        encodeBuffer = static_cast<uint8_t*>(std::aligned_alloc(bufferAlignment, encodeBufferSize));
     }
 
     ~SemiOfflineVector() {
-        free(onlineVec);
-        segment_manager->deallocate(offlineVec);
+        SlabAllocator::deallocate(onlineVec, onlineCapacity * sizeof(T));
+        free(encodeBuffer);
     }
 
     [[nodiscard]] size_t size() const {
@@ -102,6 +227,19 @@ public:
         return pos;
     }
 
+    /**
+     * Stores element at pos, which was allocated by the insert of another vector of the same length. Used to keep
+     * several vectors in lockstep without a common lock.
+     */
+    void insertAt(size_t pos, const T &element) {
+        assert(pos >= sizeOffline);
+        assert(pos < onlineCapacity + sizeOffline);
+        onlineVec[pos % onlineCapacity] = element;
+        size_t current = sizeTotal;
+        while (current <= pos && !sizeTotal.compare_exchange_weak(current, pos + 1)) {
+        }
+    }
+
     T &operator[](size_t pos) {
         assert(pos >= sizeOffline);
         assert(pos < onlineCapacity + sizeOffline);
@@ -115,6 +253,7 @@ public:
 
     void resize(size_t new_size) {
         if(new_size < sizeOffline) {
+            truncateOffline(new_size);
             sizeTotal = new_size;
             sizeOffline = new_size;
         }
@@ -130,9 +269,7 @@ public:
             size_t end = sizeOffline + count;
             assert(end <= required_online);
             assert(offlineCapacity >= end);
-            for (size_t i = sizeOffline; i < end; i++) {
-                offlineVec[i] = this->operator[](i);
-            }
+            writeOffline(end);
             sizeOffline = end;
         }
     }
@@ -140,11 +277,9 @@ public:
     void ensureOnlineFrom(size_t begin) {
         if (begin < sizeOffline) {
             assert(onlineCapacity >= sizeTotal - begin);
-            size_t end = sizeOffline;
+            readOffline(begin);
+            truncateOffline(begin);
             sizeOffline = begin;
-            for (size_t i = begin; i < end; i++) {
-                this->operator[](i) = offlineVec[i];
-            }
         }
         required_online = begin;
     }
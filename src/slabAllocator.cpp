@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "slabAllocator.h"
+#include "eventLog.h"
+#include "numaTopology.h"
+
+namespace {
+    constexpr size_t hugePageSize = 1 << 21;
+    // chunks smaller than a huge page are rounded to this and carved from shared slabs
+    constexpr size_t granule = 1 << 16;
+    constexpr size_t minChunksPerSlab = 8;
+    // freed chunks above this size are unmapped instead of kept for reuse
+    constexpr size_t cacheLimit = size_t(1) << 28;
+
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<void *>> freeLists;
+    size_t bytesInUse = 0;
+    size_t bytesPeak = 0;
+    size_t bytesMapped = 0;
+    size_t hugeTlbFallbacks = 0;
+
+    size_t chunkSize(size_t bytes) {
+        if (bytes >= hugePageSize) {
+            return (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+        }
+        return (std::max(bytes, size_t(1)) + granule - 1) / granule * granule;
+    }
+
+    /**
+     * Maps size bytes (a multiple of hugePageSize) aligned to hugePageSize.
+     */
+    void *mapRegion(size_t size) {
+        if (SlabAllocator::hugePages == SlabAllocator::HugePages::EXPLICIT) {
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED) {
+                NumaTopology::interleave(ptr, size);
+                return ptr;
+            }
+            if (hugeTlbFallbacks++ == 0) {
+                EventLog::write(true, "MAP_HUGETLB failed, using transparent huge pages");
+            }
+        }
+
+        // over-allocate to align the region to a huge page
+        size_t mappedSize = size + hugePageSize;
+        auto *base = static_cast<uint8_t *>(mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+        if (base == MAP_FAILED) {
+            EventLog::write(true, "mmap of " + std::to_string(mappedSize) + " bytes failed");
+            return nullptr;
+        }
+        auto offset = (hugePageSize - reinterpret_cast<uintptr_t>(base) % hugePageSize) % hugePageSize;
+        if (offset > 0) {
+            munmap(base, offset);
+        }
+        munmap(base + offset + size, hugePageSize - offset);
+        if (SlabAllocator::hugePages != SlabAllocator::HugePages::NONE) {
+            madvise(base + offset, size, MADV_HUGEPAGE);
+        }
+        NumaTopology::interleave(base + offset, size);
+        return base + offset;
+    }
+}
+
+SlabAllocator::HugePages SlabAllocator::hugePages = SlabAllocator::HugePages::TRANSPARENT;
+
+void *SlabAllocator::allocate(size_t bytes) {
+    size_t size = chunkSize(bytes);
+    std::lock_guard lck(mutex);
+
+    auto &freeList = freeLists[size];
+    if (freeList.empty()) {
+        if (size >= hugePageSize) {
+            void *ptr = mapRegion(size);
+            if (ptr == nullptr) {
+                return nullptr;
+            }
+            bytesMapped += size;
+            freeList.push_back(ptr);
+        } else {
+            size_t slabSize = (size * minChunksPerSlab + hugePageSize - 1) / hugePageSize * hugePageSize;
+            auto *slab = static_cast<uint8_t *>(mapRegion(slabSize));
+            if (slab == nullptr) {
+                return nullptr;
+            }
+            bytesMapped += slabSize;
+            for (size_t offset = 0; offset + size <= slabSize; offset += size) {
+                freeList.push_back(slab + offset);
+            }
+        }
+    }
+
+    void *ptr = freeList.back();
+    freeList.pop_back();
+    bytesInUse += size;
+    bytesPeak = std::max(bytesPeak, bytesInUse);
+    return ptr;
+}
+
+void SlabAllocator::deallocate(void *ptr, size_t bytes) {
+    if (ptr == nullptr) {
+        return;
+    }
+    size_t size = chunkSize(bytes);
+    std::lock_guard lck(mutex);
+    assert(bytesInUse >= size);
+    bytesInUse -= size;
+    if (size > cacheLimit) {
+        munmap(ptr, size);
+        bytesMapped -= size;
+    } else {
+        freeLists[size].push_back(ptr);
+    }
+}
+
+std::string SlabAllocator::summary() {
+    std::lock_guard lck(mutex);
+    return "Slab allocator: in use " + std::to_string(bytesInUse >> 20) + " MiB, peak " +
+           std::to_string(bytesPeak >> 20) + " MiB, mapped " + std::to_string(bytesMapped >> 20) +
+           " MiB, huge tlb fallbacks " + std::to_string(hugeTlbFallbacks);
+}
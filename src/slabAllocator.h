@@ -0,0 +1,58 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_SLABALLOCATOR_H
+#define SORTINGLOWERBOUNDS_SLABALLOCATOR_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Allocator for the large, long lived buffers of the search (poset containers, old gen maps, linear extension
+ * tables, online part of SemiOfflineVector). Memory is mapped in slabs that are a multiple of the huge page size,
+ * backed by huge pages if enabled and interleaved over the NUMA nodes.
+ * Freed chunks are kept in a free list per chunk size and reused, except for very large chunks which are unmapped.
+ */
+class SlabAllocator {
+public:
+    enum class HugePages {
+        NONE,
+        // madvise(MADV_HUGEPAGE), the kernel backs the memory with huge pages when it can
+        TRANSPARENT,
+        // MAP_HUGETLB from the reserved huge page pool, falls back to TRANSPARENT if the pool is exhausted
+        EXPLICIT
+    };
+
+    static HugePages hugePages;
+
+    static void *allocate(size_t bytes);
+
+    /**
+     * bytes has to be the size passed to allocate.
+     */
+    static void deallocate(void *ptr, size_t bytes);
+
+    static std::string summary();
+};
+
+#endif //SORTINGLOWERBOUNDS_SLABALLOCATOR_H
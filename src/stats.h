@@ -49,6 +49,8 @@ enum STAT {
 	NChildMapBWFindNo,
 	NChildMapBWFindYes,
 	NChildMapBWFindUnf,
+	NChildMapDiskFind,
+	NChildMapDiskRead,
 	NChildMapOldFind,
 	NChildMapOldFindNo,
 	NChildMapOldFindYes,
@@ -116,6 +118,8 @@ static constexpr std::array< StatTag, NUM_STATS >  build_array( ) noexcept
 	mat[STAT::NChildMapBWFindNo] =      StatTag{"#ChildMapBWFindNo"};
 	mat[STAT::NChildMapBWFindYes] =     StatTag{"#ChildMapBWFindYes"};
 	mat[STAT::NChildMapBWFindUnf] =     StatTag{"#ChildMapBWFindUnf"};
+	mat[STAT::NChildMapDiskFind] =      StatTag{"#ChildMapDiskFind"};
+	mat[STAT::NChildMapDiskRead] =      StatTag{"#ChildMapDiskRead"};
 	mat[STAT::NChildMapOldFind] =       StatTag{"#ChildMapOldFind"};
 	mat[STAT::NChildMapOldFindNo] =     StatTag{"#ChildMapOldFindNo"};
 	mat[STAT::NChildMapOldFindYes] =    StatTag{"#ChildMapOldFindYes"};
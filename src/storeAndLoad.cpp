@@ -24,106 +24,891 @@
 
 #include "storeAndLoad.h"
 
+#include <atomic>
 #include <fstream>
-#include <thread>
+#include <algorithm>
+#include <parallel/algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "config.h"
 #include "posetObj.h"
+#include "posetCode.h"
+#include "offlineCodec.h"
 #include "linExtCalculator.h"
+#include "searchParams.h"
+#include "eventLog.h"
+#include "threadPool.h"
 
 namespace {
     constexpr size_t bufferSize = 4096;
+    // number of posets read from disk before they are inserted in parallel
+    constexpr size_t bulkChunkSize = bufferSize * 256;
+    // average number of records per bucket of the bucket index
+    constexpr size_t recordsPerBucket = 16;
+    // records start at a multiple of this offset, so they can be used in place
+    constexpr size_t recordAlignment = 64;
+    // records per block of compressed files
+    constexpr uint32_t blockRecords = bufferSize;
+    // blocks encoded in parallel before they are written
+    constexpr size_t blocksPerThread = 8;
+
+    struct LayerKey {
+        // status and linExt band, see partitionOf
+        uint32_t partition;
+        uint32_t edges;
+        uint64_t bucketKey;
+        uint64_t hash;
+        uint64_t index;
+    };
+
+    /**
+     * Header of version 2 files, which had a single partition.
+     */
+    struct StorageHeaderV2 {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t recordSize;
+        uint32_t bucketBits;
+        uint64_t numRecords;
+        uint64_t bucketOffset;
+        uint64_t recordOffset;
+        Meta meta;
+    };
+
+    /**
+     * Header of version 3 files, which were not compressed.
+     */
+    struct StorageHeaderV3 {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t recordSize;
+        uint32_t numPartitions;
+        uint64_t numRecords;
+        uint64_t partitionOffset;
+        uint64_t recordOffset;
+        Meta meta;
+    };
+
+    // hashes are taken modulo a prime, the high bits are mixed in before they are used as bucket
+    uint64_t mixHash(uint64_t hash) {
+        hash ^= hash >> 30;
+        hash *= 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 27;
+        hash *= 0x94d049bb133111ebULL;
+        hash ^= hash >> 31;
+        return hash;
+    }
+
+    uint64_t unmixHash(uint64_t key) {
+        key ^= (key >> 31) ^ (key >> 62);
+        key *= 0x319642b2d24d8ec3ULL;
+        key ^= (key >> 27) ^ (key >> 54);
+        key *= 0x96de1b173f119089ULL;
+        key ^= (key >> 30) ^ (key >> 60);
+        return key;
+    }
+
+    /**
+     * Hash of a byte range, used for the checksums of layer files.
+     */
+    uint64_t hashBytes(const void *src, size_t len, uint64_t seed) {
+        auto ptr = static_cast<const uint8_t *>(src);
+        uint64_t result = mixHash(seed ^ len);
+        for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), ptr += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, ptr, sizeof(uint64_t));
+            result = (result ^ word) * 0x100000001b3ULL;
+            result ^= result >> 29;
+        }
+        for (; len > 0; len--, ptr++) {
+            result = (result ^ *ptr) * 0x100000001b3ULL;
+        }
+        return mixHash(result);
+    }
+
+    // seeds of the parts of a layer file that are not records or blocks
+    constexpr uint64_t headSeed = ~uint64_t(0);
+    constexpr uint64_t blockIndexSeed = ~uint64_t(1);
+
+    const std::string manifestName = "manifest";
+
+    struct ManifestHeader {
+        static constexpr char magicValue[8] = {'S', 'L', 'B', 'M', 'A', 'N', 'I', 'F'};
+        static constexpr uint32_t currentVersion = 1;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t numEntries;
+    };
+
+    struct ManifestRecord {
+        char file[128];
+        Meta meta;
+        uint64_t bytes;
+        uint64_t checksum;
+        uint32_t compressed;
+        uint32_t reserved;
+    };
+
+    const std::string stepDirName = "partial";
+    const std::string checkpointName = "checkpoint";
+
+    /**
+     * Checkpoint of an unfinished backward step, followed by a ManifestRecord for each shard.
+     */
+    struct CheckpointHeader {
+        static constexpr char magicValue[8] = {'S', 'L', 'B', 'S', 'T', 'E', 'P', '\0'};
+        static constexpr uint32_t currentVersion = 1;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        Meta meta;
+        uint64_t fingerprint;
+        uint64_t childrenDone;
+        uint64_t numShards;
+    };
+
+    uint32_t partitionOf(SortableStatus status, uint32_t linExtLog) {
+        return (uint32_t(status) << 16) | linExtLog;
+    }
+
+    /**
+     * Blocks of compressed layer files. Posets are stored as the rank of their transitive reduction (PosetCode), so
+     * the sparse reductions of the lower layers need only a few bytes. As in OfflineCodec<AnnotatedPosetObj>, the hash
+     * is recomputed for posets with a unique graph. The other hashes are stored in front of the posets, mixed and delta
+     * coded, since they are sorted inside a partition. PosetInfo is recomputed on decode.
+     */
+    class BlockCodec {
+        PosetCode code;
+
+    public:
+        explicit BlockCodec(unsigned int codeEdges) : code(codeEdges) { }
+
+        [[nodiscard]] size_t maxEncodedBytes(size_t count) const {
+            return varint::maxBytes<uint64_t>() * 2 + OfflineCodec<uint64_t>::maxEncodedBytes(count) + count * code.slotBytes();
+        }
+
+        size_t encode(const StorageRecord *src, size_t count, uint8_t *dst) const {
+            std::vector<uint64_t> keys;
+            for (size_t i = 0; i < count; i++) {
+                if (!src[i].poset.isUniqueGraph()) {
+                    keys.push_back(mixHash(src[i].hash));
+                }
+            }
+            std::vector<uint8_t> keyBytes(OfflineCodec<uint64_t>::maxEncodedBytes(keys.size()));
+            size_t numKeyBytes = OfflineCodec<uint64_t>::encode(keys.data(), keys.size(), keyBytes.data());
+            uint8_t *pos = varint::write(keys.size(), dst);
+            pos = varint::write(numKeyBytes, pos);
+            memcpy(pos, keyBytes.data(), numKeyBytes);
+            pos += numKeyBytes;
+            for (size_t i = 0; i < count; i++) {
+                [[maybe_unused]] bool encoded = code.encode(src[i].poset, pos);
+                assert(encoded);
+                pos += code.slotBytes();
+            }
+            return pos - dst;
+        }
+
+        void decode(const uint8_t *src, size_t count, StorageRecord *dst) const {
+            size_t numKeys, numKeyBytes;
+            src = varint::read(src, numKeys);
+            src = varint::read(src, numKeyBytes);
+            std::vector<uint64_t> keys(numKeys);
+            OfflineCodec<uint64_t>::decode(src, numKeys, keys.data());
+            src += numKeyBytes;
+            size_t key = 0;
+            for (size_t i = 0; i < count; i++) {
+                PosetObj poset;
+                code.decode(src, poset);
+                src += code.slotBytes();
+                PosetInfo info = PosetInfo::fromPoset(poset);
+                dst[i] = StorageRecord{};
+                dst[i].hash = poset.isUniqueGraph() ? poset.computeHash() : unmixHash(keys[key++]);
+                dst[i].numSingletons = info.GetnumSingletons();
+                dst[i].numPairs = info.GetNumPairs();
+                dst[i].poset = poset;
+            }
+            assert(key == numKeys);
+        }
+    };
+
+    void writeFully(int fd, const void *src, size_t len, size_t offset) {
+        auto ptr = static_cast<const uint8_t *>(src);
+        while (len > 0) {
+            ssize_t written = pwrite(fd, ptr, len, offset);
+            assert(written > 0);
+            ptr += written;
+            offset += written;
+            len -= written;
+        }
+    }
+
+    /**
+     * Writes num posets in the current format and returns the checksum of the file. getPoset(i) returns the i-th poset,
+     * it is called concurrently while hashing and then once more by the writer of the record. The number of linear
+     * extensions is computed for YES posets.
+     */
+    template<typename GetPoset>
+    uint64_t writeLayer(const std::filesystem::path &path, const Meta &meta, size_t num, bool compress, GetPoset getPoset) {
+        std::vector<LayerKey> keys(num);
+        ThreadPool::runRange(num, [&](ThreadPool::Worker &worker, size_t begin, size_t end) {
+            LinearExtensionCalculator &linExtCalculator = worker.linExtCalculator();
+            for (size_t i = begin; i < end; i++) {
+                PosetObj poset = getPoset(i);
+                uint64_t hash = poset.computeHash();
+                uint32_t linExtLog = 0;
+                if (poset.GetStatus() == SortableStatus::YES) {
+                    auto handle = PosetHandle::fromPoset(poset);
+                    linExtLog = StorageLayerView::linExtLogOf(linExtCalculator.calculateLinExtensionsSingleton(handle, meta.c, false, true));
+                }
+                keys[i] = LayerKey{partitionOf(poset.GetStatus(), linExtLog), PosetCode::edgeCount(poset), mixHash(hash), hash, i};
+            }
+        });
+        __gnu_parallel::sort(keys.begin(), keys.end(), [](const LayerKey &a, const LayerKey &b) {
+            if (a.partition != b.partition) {
+                return a.partition < b.partition;
+            }
+            return a.bucketKey < b.bucketKey || (a.bucketKey == b.bucketKey && a.index < b.index);
+        });
+
+        // partitions and their bucket indices
+        std::vector<StoragePartition> partitions;
+        std::vector<std::vector<uint64_t>> bucketIndices;
+        uint64_t bucketOffset = sizeof(StorageHeader);
+        for (size_t first = 0; first < num;) {
+            size_t last = first;
+            while (last < num && keys[last].partition == keys[first].partition) {
+                last++;
+            }
+            StoragePartition partition{};
+            partition.status = keys[first].partition >> 16;
+            partition.linExtLog = keys[first].partition & 0xFFFF;
+            partition.firstRecord = first;
+            partition.numRecords = last - first;
+            while ((partition.numRecords >> partition.bucketBits) > recordsPerBucket) {
+                partition.bucketBits++;
+            }
+            auto &bucketIndex = bucketIndices.emplace_back((1ULL << partition.bucketBits) + 1, 0);
+            for (size_t i = first; i < last; i++) {
+                bucketIndex[StorageLayerView::bucketOf(keys[i].hash, partition.bucketBits) + 1]++;
+            }
+            bucketIndex[0] = first;
+            for (size_t b = 1; b < bucketIndex.size(); b++) {
+                bucketIndex[b] += bucketIndex[b - 1];
+            }
+            partitions.push_back(partition);
+            first = last;
+        }
+        bucketOffset += partitions.size() * sizeof(StoragePartition);
+        for (size_t p = 0; p < partitions.size(); p++) {
+            partitions[p].bucketOffset = bucketOffset;
+            bucketOffset += bucketIndices[p].size() * sizeof(uint64_t);
+        }
+
+        StorageHeader header{};
+        std::memcpy(header.magic, StorageHeader::magicValue, sizeof(header.magic));
+        header.version = StorageHeader::currentVersion;
+        header.byteOrder = StorageHeader::byteOrderMark;
+        header.recordSize = sizeof(StorageRecord);
+        header.numPartitions = partitions.size();
+        header.blockRecords = compress ? blockRecords : 0;
+        for (const auto &key: keys) {
+            header.codeEdges = std::max(header.codeEdges, key.edges);
+        }
+        header.numRecords = num;
+        header.partitionOffset = sizeof(StorageHeader);
+        header.recordOffset = (bucketOffset + recordAlignment - 1) / recordAlignment * recordAlignment;
+        header.meta = meta;
+
+        auto makeRecord = [&](const LayerKey &key) {
+            PosetObj poset = getPoset(key.index);
+            poset.setMark(false);
+            PosetInfo info = PosetInfo::fromPoset(poset);
+            StorageRecord record{};
+            record.hash = key.hash;
+            record.numSingletons = info.GetnumSingletons();
+            record.numPairs = info.GetNumPairs();
+            record.poset = poset;
+            return record;
+        };
+
+        // sum of the hashes of all parts, so the parts can be written in any order
+        std::atomic<uint64_t> checksum = 0;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert(fd >= 0);
+        if (!compress) {
+            [[maybe_unused]] int res = ftruncate(fd, header.recordOffset + num * sizeof(StorageRecord));
+            assert(res == 0);
+
+            // the position of every record is known, each writer gathers and writes its own range of the file
+            ThreadPool::runRange(num, [&](ThreadPool::Worker &, size_t begin, size_t end) {
+                std::vector<StorageRecord> buffer;
+                buffer.reserve(bufferSize);
+                size_t bufferBegin = begin;
+                for (size_t i = begin; i < end; i++) {
+                    buffer.push_back(makeRecord(keys[i]));
+                    if (buffer.size() == bufferSize || i + 1 == end) {
+                        uint64_t bufferChecksum = 0;
+                        for (size_t k = 0; k < buffer.size(); k++) {
+                            bufferChecksum += hashBytes(&buffer[k], sizeof(StorageRecord), bufferBegin + k);
+                        }
+                        checksum += bufferChecksum;
+                        writeFully(fd, buffer.data(), sizeof(StorageRecord) * buffer.size(), header.recordOffset + bufferBegin * sizeof(StorageRecord));
+                        bufferBegin = i + 1;
+                        buffer.clear();
+                    }
+                }
+            });
+        } else {
+            // blocks are encoded in parallel, then appended in order
+            BlockCodec codec{header.codeEdges};
+            size_t numBlocks = (num + blockRecords - 1) / blockRecords;
+            size_t blocksPerRound = std::max(1u, NCT::num_threads) * blocksPerThread;
+            std::vector<uint64_t> blockIndex{0};
+            std::vector<std::vector<uint8_t>> encoded(blocksPerRound);
+            for (size_t round = 0; round < numBlocks; round += blocksPerRound) {
+                size_t roundBlocks = std::min(blocksPerRound, numBlocks - round);
+                auto encodeBlocks = [&](size_t begin, size_t end) {
+                    std::vector<StorageRecord> buffer(blockRecords);
+                    for (size_t b = begin; b < end; b++) {
+                        size_t first = (round + b) * blockRecords;
+                        size_t count = std::min<size_t>(blockRecords, num - first);
+                        for (size_t i = 0; i < count; i++) {
+                            buffer[i] = makeRecord(keys[first + i]);
+                        }
+                        encoded[b].resize(codec.maxEncodedBytes(count));
+                        encoded[b].resize(codec.encode(buffer.data(), count, encoded[b].data()));
+                        checksum += hashBytes(encoded[b].data(), encoded[b].size(), round + b);
+                    }
+                };
+                if (roundBlocks > 1 && NCT::num_threads > 1) {
+                    ThreadPool::run(NCT::num_threads, [&](ThreadPool::Worker &worker) {
+                        encodeBlocks(roundBlocks * worker.id / NCT::num_threads, roundBlocks * (worker.id + 1) / NCT::num_threads);
+                    });
+                } else {
+                    encodeBlocks(0, roundBlocks);
+                }
+                for (size_t b = 0; b < roundBlocks; b++) {
+                    writeFully(fd, encoded[b].data(), encoded[b].size(), header.recordOffset + blockIndex.back());
+                    blockIndex.push_back(blockIndex.back() + encoded[b].size());
+                }
+            }
+            header.blockIndexOffset = header.recordOffset + blockIndex.back();
+            writeFully(fd, blockIndex.data(), blockIndex.size() * sizeof(uint64_t), header.blockIndexOffset);
+            checksum += hashBytes(blockIndex.data(), blockIndex.size() * sizeof(uint64_t), blockIndexSeed);
+        }
+
+        // everything in front of the records
+        std::vector<uint8_t> head(header.recordOffset, 0);
+        std::memcpy(head.data(), &header, sizeof(StorageHeader));
+        std::memcpy(head.data() + header.partitionOffset, partitions.data(), partitions.size() * sizeof(StoragePartition));
+        for (size_t p = 0; p < partitions.size(); p++) {
+            std::memcpy(head.data() + partitions[p].bucketOffset, bucketIndices[p].data(), bucketIndices[p].size() * sizeof(uint64_t));
+        }
+        writeFully(fd, head.data(), head.size(), 0);
+        close(fd);
+        return checksum + hashBytes(head.data(), head.size(), headSeed);
+    }
+
+    /**
+     * Memory maps a whole file read only.
+     */
+    class ReadOnlyMapping {
+        int fd;
+        void *ptr;
+        size_t length;
+
+    public:
+        explicit ReadOnlyMapping(const std::filesystem::path &path) : length(std::filesystem::file_size(path)) {
+            fd = open(path.c_str(), O_RDONLY);
+            assert(fd >= 0);
+            ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            assert(ptr != MAP_FAILED);
+        }
+
+        ~ReadOnlyMapping() {
+            munmap(ptr, length);
+            close(fd);
+        }
+
+        [[nodiscard]] const uint8_t *data() const {
+            return static_cast<const uint8_t *>(ptr);
+        }
+    };
+}
+
+bool StorageHeader::isValid() const {
+    return std::memcmp(magic, magicValue, sizeof(magic)) == 0 && version == currentVersion && byteOrder == byteOrderMark &&
+           recordSize == sizeof(StorageRecord);
 }
 
-StorageEntry::StorageEntry(const Meta &meta, const std::filesystem::path &path): meta(meta), path(path) {
+StorageLayerView::StorageLayerView(const std::filesystem::path &path) {
+    fd = open(path.c_str(), O_RDONLY);
+    assert(fd >= 0);
+    length = std::filesystem::file_size(path);
+    void *ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    assert(ptr != MAP_FAILED);
+    madvise(ptr, length, MADV_SEQUENTIAL);
+    base = static_cast<const uint8_t *>(ptr);
+    assert(header().isValid());
+    if (header().isCompressed()) {
+        assert(length == header().blockIndexOffset + ((header().numRecords + header().blockRecords - 1) / header().blockRecords + 1) * sizeof(uint64_t));
+    } else {
+        assert(length == header().recordOffset + header().numRecords * sizeof(StorageRecord));
+    }
+}
 
+StorageLayerView::~StorageLayerView() {
+    munmap((void *) base, length);
+    close(fd);
 }
 
-void StorageEntry::read(PosetMap &map, bool onlyYesIntances) const {
+void StorageLayerView::readRecords(uint64_t first, uint64_t count, StorageRecord *dst) const {
+    const auto &h = header();
+    if (!h.isCompressed()) {
+        memcpy(dst, records() + first, count * sizeof(StorageRecord));
+        return;
+    }
+    auto blockIndex = reinterpret_cast<const uint64_t *>(base + h.blockIndexOffset);
+    BlockCodec codec{h.codeEdges};
+    std::vector<StorageRecord> block(h.blockRecords);
+    for (uint64_t b = first / h.blockRecords; b * h.blockRecords < first + count; b++) {
+        uint64_t blockFirst = b * h.blockRecords;
+        size_t blockCount = std::min<uint64_t>(h.blockRecords, h.numRecords - blockFirst);
+        codec.decode(base + h.recordOffset + blockIndex[b], blockCount, block.data());
+        uint64_t begin = std::max(first, blockFirst);
+        uint64_t end = std::min(first + count, blockFirst + blockCount);
+        std::copy(block.begin() + (begin - blockFirst), block.begin() + (end - blockFirst), dst + (begin - first));
+    }
+}
+
+uint64_t StorageLayerView::checksum() const {
+    const auto &h = header();
+    uint64_t result = hashBytes(base, h.recordOffset, headSeed);
+    if (!h.isCompressed()) {
+        for (uint64_t i = 0; i < h.numRecords; i++) {
+            result += hashBytes(records() + i, sizeof(StorageRecord), i);
+        }
+    } else {
+        auto blockIndex = reinterpret_cast<const uint64_t *>(base + h.blockIndexOffset);
+        uint64_t numBlocks = (h.numRecords + h.blockRecords - 1) / h.blockRecords;
+        for (uint64_t b = 0; b < numBlocks; b++) {
+            result += hashBytes(base + h.recordOffset + blockIndex[b], blockIndex[b + 1] - blockIndex[b], b);
+        }
+        result += hashBytes(blockIndex, (numBlocks + 1) * sizeof(uint64_t), blockIndexSeed);
+    }
+    return result;
+}
+
+uint64_t StorageLayerView::bucketOf(uint64_t hash, uint32_t bucketBits) {
+    if (bucketBits == 0) {
+        return 0;
+    }
+    return mixHash(hash) >> (64 - bucketBits);
+}
+
+uint32_t StorageLayerView::linExtLogOf(LinExtT linExt) {
+    uint32_t result = 0;
+    while (linExt > 1) {
+        linExt >>= 1;
+        result++;
+    }
+    return result;
+}
+
+uint16_t StorageLayerView::fingerprintOf(uint64_t hash) {
+    return mixHash(hash) & 0xFFFF;
+}
+
+void StorageLayerView::adviseRandom() const {
+    madvise((void *) base, length, MADV_RANDOM);
+}
+
+void StorageLayerView::willNeed(uint64_t firstRecord, uint64_t numRecords) const {
+    if (numRecords == 0) {
+        return;
+    }
+    const auto &h = header();
+    size_t begin, end;
+    if (h.isCompressed()) {
+        auto blockIndex = reinterpret_cast<const uint64_t *>(base + h.blockIndexOffset);
+        begin = h.recordOffset + blockIndex[firstRecord / h.blockRecords];
+        end = h.recordOffset + blockIndex[(firstRecord + numRecords - 1) / h.blockRecords + 1];
+    } else {
+        begin = h.recordOffset + firstRecord * sizeof(StorageRecord);
+        end = begin + numRecords * sizeof(StorageRecord);
+    }
+    // madvise needs a page aligned address
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t alignedBegin = begin / pageSize * pageSize;
+    madvise((void *) (base + alignedBegin), end - alignedBegin, MADV_WILLNEED);
+}
+
+StorageEntry::StorageEntry(const Meta &meta, const std::filesystem::path &path, bool compressed, uint64_t bytes, uint64_t checksum) :
+        meta(meta), path(path), compressed(compressed), bytes(bytes), checksum(checksum) {
+
+}
+
+void StorageEntry::read(PosetMap &map, bool onlyYesIntances, LinExtT minLinExt) const {
     if (onlyYesIntances && meta.numYes == 0) {
         return;
     }
-    std::fstream fstream(path, std::ios::in | std::ios::binary);
-    fstream.seekp(0, std::ios::end);
-    size_t len = fstream.tellp();
-    fstream.seekp(sizeof(Meta), std::ios::beg);
-    size_t max = meta.numUnf + meta.numYes;
-    assert(len == sizeof(Meta) + max * sizeof(PosetObj));
-
-    PosetObj buffer[bufferSize];
-    for (unsigned int i = 0; i < max; i+=bufferSize) {
-        auto num = std::min(max - i, bufferSize);
-        fstream.read((char *) buffer, sizeof(PosetObj) * num);
-        for (int j = 0; j < num; j++) {
-            auto &poset = buffer[j];
-            poset.setMark(false);
-            PosetInfo info = PosetInfo::fromPoset(poset);
-            AnnotatedPosetObj aposet{poset, PosetInfoFull{info, poset.computeHash()}, 0};
-            if (!onlyYesIntances || aposet.GetStatus() == SortableStatus::YES) {
-                map.findAndInsert(aposet);
-            }
+    assert(std::filesystem::file_size(path) == bytes);
+    StorageLayerView view(path);
+    assert(view.header().numRecords == meta.numUnf + meta.numYes);
+    uint32_t minLinExtLog = StorageLayerView::linExtLogOf(minLinExt);
+
+    // hash and PosetInfo are stored, the records are copied (or decoded) by several threads and inserted as they are
+    std::vector<AnnotatedPosetObj> annotated;
+    for (uint32_t p = 0; p < view.header().numPartitions; p++) {
+        const auto &partition = view.partitions()[p];
+        if (onlyYesIntances && (partition.status != SortableStatus::YES || partition.linExtLog < minLinExtLog)) {
+            continue;
+        }
+        view.willNeed(partition.firstRecord, partition.numRecords);
+        uint64_t partitionEnd = partition.firstRecord + partition.numRecords;
+        for (uint64_t i = partition.firstRecord; i < partitionEnd; i += bulkChunkSize) {
+            annotated.resize(std::min(partitionEnd - i, bulkChunkSize));
+            ThreadPool::runRange(annotated.size(), [&](ThreadPool::Worker &, size_t begin, size_t end) {
+                std::vector<StorageRecord> buffer(std::min(end - begin, bufferSize));
+                for (size_t j = begin; j < end; j += bufferSize) {
+                    size_t num = std::min(end - j, bufferSize);
+                    view.readRecords(i + j, num, buffer.data());
+                    for (size_t k = 0; k < num; k++) {
+                        annotated[j + k] = buffer[k].annotated();
+                    }
+                }
+            });
+
+            // insert in parallel, each thread fills its own hash maps
+            map.insertBulk(annotated);
         }
-        assert(!fstream.eof());
-        assert(!fstream.fail());
-        assert(!fstream.bad());
     }
-    fstream.close();
 }
 
-PosetStorage::PosetStorage(std::filesystem::path basePath, bool reuse) : basePath(basePath) {
+PosetStorage::PosetStorage(std::filesystem::path basePath, bool reuse, bool compress) : basePath(basePath), compress(compress), reuse(reuse) {
     // create directory
     std::filesystem::create_directories(basePath);
 
-    // scan files
-    if (reuse) {
-        for (const auto &entry: std::filesystem::directory_iterator(basePath)) {
-            const auto filename = entry.path().filename().string();
-            if (entry.is_regular_file()) {
-                std::fstream fstream(entry.path(), std::ios::in | std::ios::binary);
-                fstream.seekg(0, std::ios::beg);
-                Meta meta;
-                fstream.read(static_cast<char *>((void *) &meta), sizeof(Meta));
-                fstream.close();
-                entries.emplace_back(std::ref(meta), std::ref(entry.path()));
+    std::ifstream manifest(basePath / manifestName, std::ios::binary);
+    if (!manifest) {
+        // layers written before there was a manifest
+        scanDirectory();
+        for (auto &entry: entries) {
+            addEntry(entry, reuse);
+        }
+        writeManifest();
+        EventLog::write(false, "Created manifest for " + std::to_string(entries.size()) + " stored layers");
+        return;
+    }
+
+    ManifestHeader header{};
+    manifest.read(static_cast<char *>((void *) &header), sizeof(ManifestHeader));
+    assert(std::memcmp(header.magic, ManifestHeader::magicValue, sizeof(header.magic)) == 0);
+    assert(header.version == ManifestHeader::currentVersion && header.byteOrder == StorageHeader::byteOrderMark);
+    for (uint64_t i = 0; i < header.numEntries; i++) {
+        ManifestRecord record{};
+        manifest.read(static_cast<char *>((void *) &record), sizeof(ManifestRecord));
+        assert(!manifest.fail());
+        auto &entry = entries.emplace_back(record.meta, basePath / std::string(record.file), record.compressed != 0, record.bytes, record.checksum);
+        addEntry(entry, reuse);
+    }
+}
+
+void PosetStorage::scanDirectory() {
+    for (const auto &entry: std::filesystem::directory_iterator(basePath)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        StorageHeader header{};
+        std::fstream fstream(entry.path(), std::ios::in | std::ios::binary);
+        if (entry.file_size() >= sizeof(StorageHeader)) {
+            fstream.read(static_cast<char *>((void *) &header), sizeof(StorageHeader));
+        }
+        fstream.close();
+        if (!header.isValid()) {
+            if (!convert(entry.path(), compress)) {
+                continue;
             }
+            fstream.open(entry.path(), std::ios::in | std::ios::binary);
+            fstream.read(static_cast<char *>((void *) &header), sizeof(StorageHeader));
+            fstream.close();
         }
+        uint64_t checksum = StorageLayerView(entry.path()).checksum();
+        entries.emplace_back(header.meta, entry.path(), header.isCompressed(), std::filesystem::file_size(entry.path()), checksum);
     }
+}
+
+void PosetStorage::addEntry(const StorageEntry &entry, bool reuse) {
+    if (reuse) {
+        index.emplace(key(entry.meta.n, entry.meta.C - entry.meta.c), &entry);
+    }
+}
+
+uint64_t PosetStorage::key(unsigned int n, unsigned int remaining) {
+    return mixHash((uint64_t(n) << 32) ^ remaining);
+}
 
-    entries.reserve(entries.size() + NCT::C + 1);
+void PosetStorage::writeManifest() const {
+    auto path = basePath / manifestName;
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    std::ofstream manifest(tmpPath, std::ios::binary | std::ios::trunc);
+    ManifestHeader header{};
+    std::memcpy(header.magic, ManifestHeader::magicValue, sizeof(header.magic));
+    header.version = ManifestHeader::currentVersion;
+    header.byteOrder = StorageHeader::byteOrderMark;
+    header.numEntries = entries.size();
+    manifest.write((char *) &header, sizeof(ManifestHeader));
+    for (const auto &entry: entries) {
+        ManifestRecord record{};
+        auto file = entry.path.filename().string();
+        assert(file.size() < sizeof(record.file));
+        std::memcpy(record.file, file.data(), file.size());
+        record.meta = entry.meta;
+        record.bytes = entry.bytes;
+        record.checksum = entry.checksum;
+        record.compressed = entry.compressed;
+        manifest.write((char *) &record, sizeof(ManifestRecord));
+    }
+    manifest.close();
+    assert(!manifest.fail());
+    // readers see either the old or the new manifest
+    std::filesystem::rename(tmpPath, path);
 }
 
 PosetStorage::~PosetStorage() { }
 
-void PosetStorage::storePosets(PosetMap &map, const Meta &meta) {
-    auto path = basePath / ("n" + std::to_string(meta.n) + "c" + std::to_string(meta.c) + "_" + currentDateTime());
-    std::fstream fstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
-    fstream.write((char *) &meta, sizeof(Meta));
-    PosetObj buffer[bufferSize];
-    uint32_t idxBuf = 0;
-    for (auto& submap : map.SposetMap) {
-        auto& container = submap.container;
-        for (size_t i = 0; i < container.size(); i++) {
-            auto& poset = container.get(i);
-            buffer[idxBuf++] = poset;
-            if (idxBuf == bufferSize) {
-                fstream.write((char *) buffer, sizeof(PosetObj) * idxBuf);
-                idxBuf = 0;
-            }
+bool PosetStorage::convert(const std::filesystem::path &path, bool compress) {
+    size_t length = std::filesystem::file_size(path);
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+
+    StorageHeaderV3 headerV3{};
+    if (length >= sizeof(StorageHeaderV3)) {
+        std::fstream fstream(path, std::ios::in | std::ios::binary);
+        fstream.read(static_cast<char *>((void *) &headerV3), sizeof(StorageHeaderV3));
+        fstream.close();
+    }
+    uint32_t version = headerV3.version;
+    if (std::memcmp(headerV3.magic, StorageHeader::magicValue, sizeof(headerV3.magic)) == 0) {
+        // versions 2 and 3: uncompressed records, only the headers differ
+        Meta meta;
+        uint64_t numRecords, recordOffset;
+        if (version == 2) {
+            StorageHeaderV2 headerV2;
+            std::fstream fstream(path, std::ios::in | std::ios::binary);
+            fstream.read(static_cast<char *>((void *) &headerV2), sizeof(StorageHeaderV2));
+            fstream.close();
+            meta = headerV2.meta;
+            numRecords = headerV2.numRecords;
+            recordOffset = headerV2.recordOffset;
+        } else if (version == 3) {
+            meta = headerV3.meta;
+            numRecords = headerV3.numRecords;
+            recordOffset = headerV3.recordOffset;
+        } else {
+            return false;
+        }
+        if (headerV3.byteOrder != StorageHeader::byteOrderMark || headerV3.recordSize != sizeof(StorageRecord) || meta.n != NCT::N ||
+            length != recordOffset + numRecords * sizeof(StorageRecord)) {
+            return false;
+        }
+        ReadOnlyMapping mapping(path);
+        auto records = reinterpret_cast<const StorageRecord *>(mapping.data() + recordOffset);
+        writeLayer(tmpPath, meta, numRecords, compress, [&](size_t i) {
+            return records[i].poset;
+        });
+    } else {
+        // version 1: raw Meta followed by raw PosetObj
+        if (length < sizeof(Meta)) {
+            return false;
         }
+        Meta meta;
+        std::fstream fstream(path, std::ios::in | std::ios::binary);
+        fstream.read(static_cast<char *>((void *) &meta), sizeof(Meta));
+        fstream.close();
+        size_t num = meta.numYes + meta.numUnf;
+        if (meta.n != NCT::N || length != sizeof(Meta) + num * sizeof(PosetObj)) {
+            return false;
+        }
+        ReadOnlyMapping mapping(path);
+        auto posets = reinterpret_cast<const PosetObj *>(mapping.data() + sizeof(Meta));
+        writeLayer(tmpPath, meta, num, compress, [&](size_t i) {
+            return posets[i];
+        });
+        version = 1;
+    }
+    std::filesystem::rename(tmpPath, path);
+
+    EventLog::write(false, "Converted layer file " + path.filename().string() + " from format version " + std::to_string(version) +
+                           " to " + std::to_string(StorageHeader::currentVersion));
+    return true;
+}
+
+uint64_t PosetStorage::writeMap(PosetMap &map, const Meta &meta, const std::filesystem::path &path) const {
+    // global index -> (submap, index), the records are written sorted by partition and bucket
+    std::vector<size_t> offsets(1, 0);
+    for (auto &submap : map.SposetMap) {
+        offsets.push_back(offsets.back() + submap.container.size());
     }
-    if (idxBuf > 0) {
-        fstream.write((char *) buffer, sizeof(PosetObj) * idxBuf);
+    return writeLayer(path, meta, offsets.back(), compress, [&](size_t i) {
+        size_t submap = std::upper_bound(offsets.begin(), offsets.end(), i) - offsets.begin() - 1;
+        return map.SposetMap[submap].container.get(i - offsets[submap]);
+    });
+}
+
+void PosetStorage::storePosets(PosetMap &map, const Meta &meta) {
+    // layers of several C share the directory, runs can finish a layer in the same second
+    auto name = "n" + std::to_string(meta.n) + "C" + std::to_string(meta.C) + "c" + std::to_string(meta.c) + "_" + currentDateTime();
+    auto path = basePath / name;
+    for (int i = 1; std::filesystem::exists(path); i++) {
+        path = basePath / (name + "_" + std::to_string(i));
     }
-    fstream.close();
-    entries.emplace_back(std::ref(meta), std::ref(path));
+    uint64_t checksum = writeMap(map, meta, path);
+    addEntry(entries.emplace_back(meta, path, compress, std::filesystem::file_size(path), checksum), true);
+    writeManifest();
 }
 
 const StorageEntry * PosetStorage::getEntry(unsigned int c, LinExtT limit) {
-    for (const auto &entry : entries) {
-        if (entry.meta.n == NCT::N && entry.meta.C == NCT::C && entry.meta.c == c && entry.meta.completeAbove == limit) {
-            return &entry;
+    const StorageEntry *result = nullptr;
+    auto range = index.equal_range(key(NCT::N, NCT::C - c));
+    for (auto it = range.first; it != range.second; it++) {
+        const auto &entry = *it->second;
+        if (entry.meta.n != NCT::N || entry.meta.C - entry.meta.c != NCT::C - c) {
+            continue;
+        }
+        // the posets of layer c have at most c edges, so a layer with a larger edge limit (from a larger C) holds all
+        // of them, and it is complete for the limit if it is complete above a smaller number of linear extensions
+        if (entry.meta.c < c || entry.meta.completeAbove > limit) {
+            continue;
+        }
+        // the result of the search is taken from the number of posets in layer 0
+        if (c == 0 && entry.meta.c != 0) {
+            continue;
+        }
+        uint64_t size = entry.meta.numYes + entry.meta.numUnf;
+        uint64_t resultSize = result ? result->meta.numYes + result->meta.numUnf : 0;
+        if (result == nullptr || size < resultSize || (size == resultSize && entry.meta.c < result->meta.c)) {
+            result = &entry;
         }
     }
-    return nullptr;
+    return result;
 }
 
+std::filesystem::path PosetStorage::stepPath() const {
+    return basePath / stepDirName;
+}
+
+const StepProgress &PosetStorage::resumeStep(const Meta &meta, uint64_t fingerprint) {
+    stepMeta = meta;
+    stepFingerprint = fingerprint;
+    step = StepProgress{};
+
+    std::ifstream checkpoint(stepPath() / checkpointName, std::ios::binary);
+    if (!checkpoint || !reuse) {
+        discardStep();
+        return step;
+    }
+    CheckpointHeader header{};
+    checkpoint.read(static_cast<char *>((void *) &header), sizeof(CheckpointHeader));
+    bool valid = !checkpoint.fail() && std::memcmp(header.magic, CheckpointHeader::magicValue, sizeof(header.magic)) == 0 &&
+                 header.version == CheckpointHeader::currentVersion && header.byteOrder == StorageHeader::byteOrderMark &&
+                 header.meta.n == meta.n && header.meta.C == meta.C && header.meta.c == meta.c &&
+                 header.meta.completeAbove == meta.completeAbove && header.fingerprint == fingerprint;
+    for (uint64_t i = 0; valid && i < header.numShards; i++) {
+        ManifestRecord record{};
+        checkpoint.read(static_cast<char *>((void *) &record), sizeof(ManifestRecord));
+        auto path = stepPath() / std::string(record.file);
+        // shards written after the last checkpoint or damaged by the interruption are not used
+        valid = !checkpoint.fail() && std::filesystem::exists(path) && std::filesystem::file_size(path) == record.bytes &&
+                StorageLayerView(path).checksum() == record.checksum;
+        if (valid) {
+            step.shards.emplace_back(record.meta, path, record.compressed != 0, record.bytes, record.checksum);
+        }
+    }
+    checkpoint.close();
+    if (!valid) {
+        EventLog::write(false, "Discarding checkpoint of another backward step");
+        discardStep();
+        return step;
+    }
+    step.childrenDone = header.childrenDone;
+    return step;
+}
+
+void PosetStorage::storeShard(PosetMap &map, uint64_t childrenDone) {
+    auto stats = map.countPosetsDetailed();
+    Meta meta = stepMeta;
+    meta.numYes = stats[SortableStatus::YES];
+    meta.numUnf = stats[SortableStatus::UNFINISHED];
+    auto path = stepPath() / ("n" + std::to_string(meta.n) + "c" + std::to_string(meta.c) + "_shard" + std::to_string(step.shards.size()));
+    uint64_t checksum = writeMap(map, meta, path);
+    step.shards.emplace_back(meta, path, compress, std::filesystem::file_size(path), checksum);
+    step.childrenDone = childrenDone;
+    writeCheckpoint();
+    EventLog::write(false, "Stored shard " + std::to_string(step.shards.size()) + " of parent layer c=" + std::to_string(meta.c) + " with " +
+                           std::to_string(meta.numYes + meta.numUnf) + " posets, " + std::to_string(childrenDone) + " children done");
+}
+
+void PosetStorage::finishStep() {
+    discardStep();
+    step = StepProgress{};
+}
+
+void PosetStorage::writeCheckpoint() const {
+    auto path = stepPath() / checkpointName;
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    std::ofstream checkpoint(tmpPath, std::ios::binary | std::ios::trunc);
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CheckpointHeader::magicValue, sizeof(header.magic));
+    header.version = CheckpointHeader::currentVersion;
+    header.byteOrder = StorageHeader::byteOrderMark;
+    header.meta = stepMeta;
+    header.fingerprint = stepFingerprint;
+    header.childrenDone = step.childrenDone;
+    header.numShards = step.shards.size();
+    checkpoint.write((char *) &header, sizeof(CheckpointHeader));
+    for (const auto &shard: step.shards) {
+        ManifestRecord record{};
+        auto file = shard.path.filename().string();
+        assert(file.size() < sizeof(record.file));
+        std::memcpy(record.file, file.data(), file.size());
+        record.meta = shard.meta;
+        record.bytes = shard.bytes;
+        record.checksum = shard.checksum;
+        record.compressed = shard.compressed;
+        checkpoint.write((char *) &record, sizeof(ManifestRecord));
+    }
+    checkpoint.close();
+    assert(!checkpoint.fail());
+    // the shard is complete before the checkpoint refers to it
+    std::filesystem::rename(tmpPath, path);
+}
+
+void PosetStorage::discardStep() {
+    std::filesystem::remove_all(stepPath());
+    std::filesystem::create_directories(stepPath());
+}
+
+uint64_t PosetStorage::fingerprint(const std::vector<PosetObj> &posets) {
+    std::atomic<uint64_t> result = hashBytes(nullptr, 0, posets.size());
+    ThreadPool::runRange(posets.size(), [&](ThreadPool::Worker &, size_t begin, size_t end) {
+        uint64_t partial = 0;
+        for (size_t i = begin; i < end; i++) {
+            // PosetObj has padding, so its bytes are not hashed
+            uint64_t hash = posets[i].computeHash();
+            partial += hashBytes(&hash, sizeof(hash), i);
+        }
+        result += partial;
+    });
+    return result;
+}
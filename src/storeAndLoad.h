@@ -24,11 +24,13 @@
 #ifndef STORELOAD_H
 #define STORELOAD_H
 
+#include <deque>
 #include <filesystem>
+#include <unordered_map>
 #include <vector>
 #include "posetMap.h"
+#include "posetObj.h"
 
-class AnnotatedPosetObj;
 
 struct Meta {
 	unsigned int n;
@@ -44,31 +46,246 @@ struct Meta {
 	}
 };
 
+/**
+ * Records of one status (and for YES of one linExt band) in a layer file, with their own bucket index of
+ * numBuckets + 1 indices into the records of the file at bucketOffset. Partitions are sorted by status and band.
+ */
+struct StoragePartition {
+	uint32_t status;
+	// YES posets of the partition have [2^linExtLog, 2^(linExtLog+1)) linear extensions, 0 for other statuses
+	uint32_t linExtLog;
+	uint32_t bucketBits;
+	uint32_t reserved;
+	uint64_t firstRecord;
+	uint64_t numRecords;
+	uint64_t bucketOffset;
+};
+
+/**
+ * Header of a layer file (format version 4). It is followed by numPartitions StoragePartition, their bucket indices
+ * and the records at recordOffset. Inside a partition the records are sorted by their bucket, see
+ * StorageLayerView::bucketOf. Compressed files store blocks of blockRecords records instead, encoded with PosetCode
+ * for codeEdges edges. The byte offsets of the blocks relative to recordOffset are stored at
+ * blockIndexOffset. Older files (version 1: a raw Meta followed by raw PosetObj, version 2: a single partition,
+ * version 3: uncompressed only) are converted on load.
+ */
+struct StorageHeader {
+	static constexpr char magicValue[8] = {'S', 'L', 'B', 'L', 'A', 'Y', 'E', 'R'};
+	static constexpr uint32_t currentVersion = 4;
+	static constexpr uint32_t byteOrderMark = 0x01020304;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t recordSize;
+	uint32_t numPartitions;
+	// 0 if the records are not compressed
+	uint32_t blockRecords;
+	uint32_t codeEdges;
+	uint64_t numRecords;
+	uint64_t partitionOffset;
+	uint64_t recordOffset;
+	uint64_t blockIndexOffset;
+	Meta meta;
+
+	[[nodiscard]] bool isValid() const;
+
+	[[nodiscard]] bool isCompressed() const {
+		return blockRecords != 0;
+	}
+};
+
+/**
+ * A poset of a layer file with its hash and PosetInfo, so readers do not have to recompute them. The mark is cleared.
+ */
+struct StorageRecord {
+	uint64_t hash;
+	uint8_t numSingletons;
+	uint8_t numPairs;
+	PosetObj poset;
+
+	[[nodiscard]] AnnotatedPosetObj annotated() const {
+		return AnnotatedPosetObj{poset, PosetInfoFull{PosetInfo(numSingletons, numPairs), hash}, 0};
+	}
+};
+
+/**
+ * Read only memory mapping of a layer file, records can be used in place.
+ */
+class StorageLayerView {
+	int fd;
+	const uint8_t *base;
+	size_t length;
+
+public:
+	explicit StorageLayerView(const std::filesystem::path &path);
+	~StorageLayerView();
+
+	StorageLayerView(const StorageLayerView&) = delete;
+	StorageLayerView& operator= (const StorageLayerView&) = delete;
+
+	[[nodiscard]] const StorageHeader &header() const {
+		return *reinterpret_cast<const StorageHeader *>(base);
+	}
+
+	[[nodiscard]] const StoragePartition *partitions() const {
+		return reinterpret_cast<const StoragePartition *>(base + header().partitionOffset);
+	}
+
+	[[nodiscard]] const uint64_t *bucketIndex(const StoragePartition &partition) const {
+		return reinterpret_cast<const uint64_t *>(base + partition.bucketOffset);
+	}
+
+	/**
+	 * Records of an uncompressed file, they can be used in place.
+	 */
+	[[nodiscard]] const StorageRecord *records() const {
+		assert(!header().isCompressed());
+		return reinterpret_cast<const StorageRecord *>(base + header().recordOffset);
+	}
+
+	/**
+	 * Copies the records [first, first + count) to dst, decoding the blocks that contain them if compressed.
+	 */
+	void readRecords(uint64_t first, uint64_t count, StorageRecord *dst) const;
+
+	/**
+	 * Records are accessed by lookups from now on, disables read ahead.
+	 */
+	void adviseRandom() const;
+
+	/**
+	 * Checksum of the file contents, independent of the order in which the records were written.
+	 */
+	[[nodiscard]] uint64_t checksum() const;
+
+	/**
+	 * Starts reading the records [firstRecord, firstRecord + numRecords) in the background.
+	 */
+	void willNeed(uint64_t firstRecord, uint64_t numRecords) const;
+
+	static uint64_t bucketOf(uint64_t hash, uint32_t bucketBits);
+
+	/**
+	 * Band of a number of linear extensions, floor(log2(linExt)).
+	 */
+	static uint32_t linExtLogOf(LinExtT linExt);
+
+	/**
+	 * Short fingerprint of a hash, independent of its bucket.
+	 */
+	static uint16_t fingerprintOf(uint64_t hash);
+};
+
 class StorageEntry {
 
 public:
 	const std::filesystem::path path;
 	const Meta meta;
+	const bool compressed;
+	// size and checksum of the file when it was written, see StorageLayerView::checksum
+	const uint64_t bytes;
+	const uint64_t checksum;
+
+	StorageEntry(const Meta &meta, const std::filesystem::path &path, bool compressed, uint64_t bytes, uint64_t checksum);
 
-	StorageEntry(const Meta &meta, const std::filesystem::path &path);
+	/**
+	 * Inserts the posets of the layer into map. Only the partitions that can hold YES posets with at least
+	 * minLinExt linear extensions are read if onlyYesIntances is set. The file is opened only here.
+	 */
+	void read(PosetMap &map, bool onlyYesIntances = false, LinExtT minLinExt = 1) const;
+};
 
-	void read(PosetMap &map, bool onlyYesIntances = false) const;
+/**
+ * Unfinished backward step. The parents of the children [0, childrenDone) are stored in the shards.
+ */
+struct StepProgress {
+	uint64_t childrenDone = 0;
+	std::vector<StorageEntry> shards;
 };
 
+/**
+ * Directory of stored layers. The layers are listed in a manifest file in the directory, so files are only opened
+ * when a layer is read. Directories without a manifest are scanned once (converting files of older versions) and a
+ * manifest is created. The manifest is replaced atomically whenever a layer is stored.
+ */
 class PosetStorage {
 
 private:
 	std::filesystem::path basePath;
-	std::vector<StorageEntry> entries;
+	// all layers of the manifest, the deque keeps pointers to entries valid
+	std::deque<StorageEntry> entries;
+	// layers that can be reused by key(n, C - c)
+	std::unordered_multimap<uint64_t, const StorageEntry *> index;
+	bool compress;
+	bool reuse;
+
+	static uint64_t key(unsigned int n, unsigned int remaining);
+
+	void addEntry(const StorageEntry &entry, bool reuse);
+
+	void scanDirectory();
+
+	void writeManifest() const;
+
+	// backward step whose parent layer is written in shards, see resumeStep
+	Meta stepMeta{};
+	uint64_t stepFingerprint = 0;
+	StepProgress step;
+
+	[[nodiscard]] std::filesystem::path stepPath() const;
+
+	uint64_t writeMap(PosetMap &map, const Meta &meta, const std::filesystem::path &path) const;
+
+	void writeCheckpoint() const;
+
+	void discardStep();
 
 public:
 
-	explicit PosetStorage(std::filesystem::path basePath, bool reuse);
+	/**
+	 * Layers are stored compressed if compress is set, reused files of older versions are converted accordingly.
+	 */
+	explicit PosetStorage(std::filesystem::path basePath, bool reuse, bool compress = false);
 	~PosetStorage();
 
 	void storePosets(PosetMap &map, const Meta &meta);
 
+	/**
+	 * Rewrites a layer file of an older version for the current N in the current format. Returns false if path is not
+	 * such a file.
+	 */
+	static bool convert(const std::filesystem::path &path, bool compress);
+
+	/**
+	 * Stored layer for layer c of the current N and C that is complete above limit, or nullptr. Layers are matched by
+	 * the number of remaining comparisons C - c, so layers of runs with a larger C can be used as well. They also
+	 * contain posets with more than c edges, which are not needed. The smallest matching layer is returned.
+	 */
     const StorageEntry * getEntry(unsigned int c, LinExtT limit);
+
+	/**
+	 * Starts the backward step for the parent layer meta.c with meta.completeAbove. If an earlier run was interrupted
+	 * during the same step with the same children (see fingerprint) and layers are reused, its checkpoint is
+	 * returned, otherwise the progress is empty. Shards of other steps are deleted.
+	 */
+	const StepProgress &resumeStep(const Meta &meta, uint64_t fingerprint);
+
+	/**
+	 * Writes the parents in map to a new shard of the current step and records that the children [0, childrenDone)
+	 * are done. The checkpoint is replaced atomically.
+	 */
+	void storeShard(PosetMap &map, uint64_t childrenDone);
+
+	/**
+	 * Deletes the shards and the checkpoint of the current step, after its parent layer has been stored.
+	 */
+	void finishStep();
+
+	/**
+	 * Fingerprint of the posets and their order.
+	 */
+	static uint64_t fingerprint(const std::vector<PosetObj> &posets);
 };
 
 #endif
@@ -0,0 +1,131 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "threadPool.h"
+
+#include <cassert>
+
+#include "config.h"
+#include "linExtCalculator.h"
+#include "numaTopology.h"
+
+namespace {
+    // set in the pool's threads, jobs must not start other jobs
+    thread_local bool insideWorker = false;
+}
+
+ThreadPool::Worker::Worker(unsigned int id) : id(id) {
+
+}
+
+ThreadPool::Worker::~Worker() = default;
+
+LinearExtensionCalculator &ThreadPool::Worker::linExtCalculator() {
+    if (!calculator || calculatorC != NCT::C) {
+        calculator = std::make_unique<LinearExtensionCalculator>(NCT::N, NCT::C);
+        calculatorC = NCT::C;
+    }
+    return *calculator;
+}
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start(unsigned int numThreads) {
+    stop();
+    stopping = false;
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.push_back(std::make_unique<Worker>(i));
+    }
+    for (unsigned int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&ThreadPool::loop, this, std::ref(*workers[i]));
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    threads.clear();
+    workers.clear();
+}
+
+void ThreadPool::loop(Worker &worker) {
+    insideWorker = true;
+    NumaTopology::pinWorker(worker.id);
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(Worker &)> *current;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            wakeup.wait(lock, [&]() {
+                return stopping || (generation != seen && worker.id < numActive);
+            });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            current = job;
+        }
+
+        NCT::initThread();
+        (*current)(worker);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (--pending == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::run(unsigned int numWorkers, const std::function<void(Worker &)> &job) {
+    assert(!insideWorker);
+    auto &pool = instance();
+    std::lock_guard<std::mutex> runLock{pool.runMutex};
+    if (pool.workers.size() != NCT::num_threads) {
+        pool.start(NCT::num_threads);
+    }
+    assert(numWorkers >= 1 && numWorkers <= pool.workers.size());
+
+    std::unique_lock<std::mutex> lock{pool.mutex};
+    pool.job = &job;
+    pool.numActive = numWorkers;
+    pool.pending = numWorkers;
+    pool.generation++;
+    pool.wakeup.notify_all();
+    pool.done.wait(lock, [&]() {
+        return pool.pending == 0;
+    });
+    pool.job = nullptr;
+}
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_THREADPOOL_H
+#define SORTINGLOWERBOUNDS_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "edgeListWord.h"
+#include "searchParams.h"
+
+class LinearExtensionCalculator;
+
+/**
+ * Worker threads that live as long as the program. The parallel sections of the searches hand their work to run()
+ * instead of starting and joining threads in every step, and each worker keeps its scratch state between them. The
+ * workers are pinned to their NUMA node once, when they are started.
+ */
+class ThreadPool {
+
+public:
+
+    /**
+     * Scratch state of a worker, kept between jobs.
+     */
+    class Worker {
+        std::unique_ptr<LinearExtensionCalculator> calculator;
+        unsigned int calculatorC = 0;
+
+    public:
+        const unsigned int id;
+
+        // local edge lists of the forward search
+        std::vector<EdgeListWord::Type> edgeList;
+        std::vector<uint64_t> childIndices;
+
+        explicit Worker(unsigned int id);
+        ~Worker();
+
+        /**
+         * Calculator for the current N and C, it is only allocated again if C changes.
+         */
+        LinearExtensionCalculator &linExtCalculator();
+    };
+
+    /**
+     * Runs job(worker) on the first numWorkers workers and returns when all of them are done. The workers call
+     * NCT::initThread before every job. The pool is (re)started with NCT::num_threads workers if their number
+     * changed. Must not be called from a job.
+     */
+    static void run(unsigned int numWorkers, const std::function<void(Worker &)> &job);
+
+    /**
+     * Runs work(worker, begin, end) on num items, split into consecutive parts over all workers if there are enough
+     * items.
+     */
+    template<typename Work>
+    static void runRange(size_t num, Work work) {
+        unsigned int numWorkers = num > SearchParams::batchSize * 4 && NCT::num_threads > 1 ? NCT::num_threads : 1;
+        run(numWorkers, [&](Worker &worker) {
+            work(worker, num * worker.id / numWorkers, num * (worker.id + 1) / numWorkers);
+        });
+    }
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable done;
+    // incremented for every job, workers wait for a new generation
+    uint64_t generation = 0;
+    unsigned int numActive = 0;
+    unsigned int pending = 0;
+    bool stopping = false;
+    const std::function<void(Worker &)> *job = nullptr;
+
+    // only one job at a time
+    std::mutex runMutex;
+
+    ThreadPool() = default;
+    ~ThreadPool();
+
+    static ThreadPool &instance();
+
+    void start(unsigned int numThreads);
+
+    void stop();
+
+    void loop(Worker &worker);
+};
+
+#endif //SORTINGLOWERBOUNDS_THREADPOOL_H
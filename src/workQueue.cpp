@@ -0,0 +1,64 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "workQueue.h"
+
+#include <algorithm>
+
+namespace {
+    // a chunk is this fraction of the remaining indices per worker
+    constexpr size_t chunkDivisor = 4;
+}
+
+WorkQueue::WorkQueue(size_t begin, size_t end, unsigned int numWorkers, size_t minChunk) :
+        next(begin), begin(begin), end(end), numWorkers(std::max(1u, numWorkers)), minChunk(std::max<size_t>(1, minChunk)),
+        counters(this->numWorkers) {
+
+}
+
+bool WorkQueue::claim(size_t &chunkBegin, size_t &chunkEnd, size_t maxChunk) {
+    size_t current = next.load(std::memory_order_relaxed);
+    while (current < end) {
+        size_t chunk = (end - current) / (chunkDivisor * numWorkers);
+        chunk = std::max(minChunk, std::min(chunk, maxChunk));
+        size_t chunkLast = std::min(end, current + chunk);
+        if (next.compare_exchange_weak(current, chunkLast, std::memory_order_relaxed)) {
+            chunkBegin = current;
+            chunkEnd = chunkLast;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t WorkQueue::done() const {
+    uint64_t result = 0;
+    for (const auto &counter: counters) {
+        result += counter.done.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+size_t WorkQueue::position() const {
+    return std::min(next.load(std::memory_order_relaxed), end);
+}
@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2022 Florian Stober and Armin Weiß
+// Institute for Formal Methods of Computer Science, University of Stuttgart
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SORTINGLOWERBOUNDS_WORKQUEUE_H
+#define SORTINGLOWERBOUNDS_WORKQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Hands out the indices [begin, end) of a parallel section in chunks. Chunks are claimed in increasing order, so the
+ * claimed indices are always a prefix of the range, even if the workers stop early. Chunks start large and shrink
+ * towards the end of the range (guided scheduling): the shared cursor is touched rarely while the cost of the posets
+ * varies a lot, and the last chunks are small enough that no worker is left with a long tail. Finished indices are
+ * counted per worker, so reporting progress does not write a shared cache line.
+ */
+class WorkQueue {
+
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> done{0};
+    };
+
+    alignas(64) std::atomic<size_t> next;
+    const size_t begin;
+    const size_t end;
+    const unsigned int numWorkers;
+    const size_t minChunk;
+    std::vector<Counter> counters;
+
+public:
+    WorkQueue(size_t begin, size_t end, unsigned int numWorkers, size_t minChunk);
+
+    /**
+     * Claims the next chunk [chunkBegin, chunkEnd) of at least minChunk (unless the range ends) and at most
+     * max(maxChunk, minChunk) indices. Returns false if the range is exhausted.
+     */
+    bool claim(size_t &chunkBegin, size_t &chunkEnd, size_t maxChunk = std::numeric_limits<size_t>::max());
+
+    /**
+     * Counts count finished indices of a worker.
+     */
+    void finished(unsigned int worker, size_t count) {
+        counters[worker].done.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of finished indices of all workers.
+     */
+    [[nodiscard]] uint64_t done() const;
+
+    /**
+     * End of the claimed prefix of the range.
+     */
+    [[nodiscard]] size_t position() const;
+};
+
+#endif //SORTINGLOWERBOUNDS_WORKQUEUE_H